@@ -0,0 +1,79 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_BENCH_HPP
+#define XCPP_BENCH_HPP
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace xcpp
+{
+    /**
+     * Helpers for the body of %%bench and %timeit, which keep the compiler
+     * from removing the computation being measured:
+     *
+     *     auto r = f(x);
+     *     xcpp::do_not_optimize(r);
+     */
+
+#if defined(__GNUC__) || defined(__clang__)
+
+    // The value is assumed to be read, so it has to be computed.
+    template <class T>
+    inline void do_not_optimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // The value is assumed to be read and modified, so it can be neither
+    // removed nor assumed constant by the following code.
+    template <class T>
+    inline void do_not_optimize(T& value)
+    {
+#if defined(__clang__)
+        asm volatile("" : "+r,m"(value) : : "memory");
+#else
+        asm volatile("" : "+m,r"(value) : : "memory");
+#endif
+    }
+
+    // All memory is assumed to be read and written, so pending stores have
+    // to be performed.
+    inline void clobber_memory()
+    {
+        asm volatile("" : : : "memory");
+    }
+
+#else
+
+    namespace detail
+    {
+        inline void use_char_pointer(const volatile char*)
+        {
+        }
+    }
+
+    template <class T>
+    inline void do_not_optimize(const T& value)
+    {
+        detail::use_char_pointer(&reinterpret_cast<const volatile char&>(value));
+        _ReadWriteBarrier();
+    }
+
+    inline void clobber_memory()
+    {
+        _ReadWriteBarrier();
+    }
+
+#endif
+}
+
+#endif
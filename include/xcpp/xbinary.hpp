@@ -0,0 +1,142 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_BINARY_HPP
+#define XCPP_BINARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus-cling/xeus_cling_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    /**
+     * Non-owning view of a contiguous range of bytes.
+     */
+    struct bytes_view
+    {
+        bytes_view(const void* data, std::size_t size)
+            : data(data)
+            , size(size)
+        {
+        }
+
+        template <class T>
+        bytes_view(const std::vector<T>& v)
+            : data(v.data())
+            , size(v.size() * sizeof(T))
+        {
+        }
+
+        bytes_view(const std::string& s)
+            : data(s.data())
+            , size(s.size())
+        {
+        }
+
+        const void* data;
+        std::size_t size;
+    };
+
+    // Encodes the bytes in a single pass into a string of the final size.
+    // It is compiled with the kernel, so it runs at full speed regardless
+    // of the optimization level of the notebook.
+    XEUS_CLING_API std::string base64_encode(bytes_view bytes);
+
+    /**
+     * Read-only content of a file, memory-mapped when possible.
+     */
+    class XEUS_CLING_API mapped_file
+    {
+    public:
+
+        // Throws std::runtime_error if the file cannot be read.
+        explicit mapped_file(const std::string& path);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        bytes_view bytes() const;
+
+    private:
+
+        const char* p_data;
+        std::size_t m_size;
+        bool m_mapped;
+        std::string m_content;
+    };
+
+    /**
+     * Binary content of the given mime type (e.g. "image/png"), displayed
+     * with xcpp::display. The bytes are base64-encoded straight from their
+     * storage into the message, without any intermediate copy.
+     */
+    class binary_data
+    {
+    public:
+
+        binary_data(std::string mime_type, bytes_view bytes, std::shared_ptr<const void> owner = nullptr)
+            : m_mime_type(std::move(mime_type))
+            , m_bytes(bytes)
+            , p_owner(std::move(owner))
+        {
+        }
+
+        const std::string& mime_type() const
+        {
+            return m_mime_type;
+        }
+
+        bytes_view bytes() const
+        {
+            return m_bytes;
+        }
+
+    private:
+
+        std::string m_mime_type;
+        bytes_view m_bytes;
+        // Keeps the storage of the bytes alive, if owned.
+        std::shared_ptr<const void> p_owner;
+    };
+
+    // The bytes must outlive the returned object.
+    inline binary_data binary(std::string mime_type, bytes_view bytes)
+    {
+        return binary_data(std::move(mime_type), bytes);
+    }
+
+    // Maps the file, which is unmapped when the returned object and its
+    // copies are destroyed.
+    inline binary_data binary_file(std::string mime_type, const std::string& path)
+    {
+        auto file = std::make_shared<const mapped_file>(path);
+        bytes_view bytes = file->bytes();
+        return binary_data(std::move(mime_type), bytes, std::move(file));
+    }
+
+    inline nl::json mime_bundle_repr(const binary_data& value)
+    {
+        auto bundle = nl::json::object();
+        bundle[value.mime_type()] = base64_encode(value.bytes());
+        return bundle;
+    }
+}
+
+#endif
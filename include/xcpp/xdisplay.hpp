@@ -12,17 +12,26 @@
 
 #include <nlohmann/json.hpp>
 
+#include "xeus-cling/xeus_cling_config.hpp"
+
+#include "xbinary.hpp"
 #include "xmime.hpp"
 
 namespace nl = nlohmann;
 
 namespace xcpp
 {
+    // Publishes a display_data, or an update_display_data message if update
+    // is true. Unlike xeus::xinterpreter::display_data, this can be called
+    // from any thread: the messages are sent by the interpreter thread,
+    // after the stream output written before them.
+    XEUS_CLING_API void publish_display_data(nl::json data, nl::json metadata, nl::json transient, bool update = false);
+
     template <class T>
     void display(const T& t)
     {
         using ::xcpp::mime_bundle_repr;
-        xeus::get_interpreter().display_data(mime_bundle_repr(t), nl::json::object(), nl::json::object());
+        publish_display_data(mime_bundle_repr(t), nl::json::object(), nl::json::object());
     }
 
     template <class T>
@@ -31,15 +40,7 @@ namespace xcpp
         nl::json transient;
         transient["display_id"] = id;
         using ::xcpp::mime_bundle_repr;
-        if (update)
-        {
-            xeus::get_interpreter()
-                .update_display_data(mime_bundle_repr(t), nl::json::object(), std::move(transient));
-        }
-        else
-        {
-            xeus::get_interpreter().display_data(mime_bundle_repr(t), nl::json::object(), std::move(transient));
-        }
+        publish_display_data(mime_bundle_repr(t), nl::json::object(), std::move(transient), update);
     }
 
     inline void clear_output(bool wait = false)
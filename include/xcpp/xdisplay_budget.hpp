@@ -0,0 +1,42 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_DISPLAY_BUDGET_HPP
+#define XCPP_DISPLAY_BUDGET_HPP
+
+#include <cstddef>
+
+#include "xeus-cling/xeus_cling_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Limits honoured by the default mime_bundle_repr implementations, so
+     * that displaying a huge container stays cheap.
+     *
+     * Containers with more than max_elements elements are summarized with
+     * their first and last edge_items elements and their size, containers
+     * nested deeper than max_depth are elided, and text representations are
+     * cut after max_bytes bytes.
+     */
+    struct display_budget
+    {
+        std::size_t max_elements = 1000;
+        std::size_t edge_items = 3;
+        std::size_t max_depth = 8;
+        std::size_t max_bytes = std::size_t(1) << 16;
+    };
+
+    // The budget of the kernel, which can be changed with the
+    // %display_budget magic. Custom mime_bundle_repr overloads should
+    // honour it as well.
+    XEUS_CLING_API display_budget& get_display_budget();
+}
+
+#endif
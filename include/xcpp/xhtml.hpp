@@ -0,0 +1,50 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_HTML_HPP
+#define XCPP_HTML_HPP
+
+#include <string>
+
+namespace xcpp
+{
+    namespace detail
+    {
+        // Escapes the text inserted in the text/html representations,
+        // either as element content or as a quoted attribute value.
+        inline std::string html_escape(const std::string& str)
+        {
+            std::string res;
+            res.reserve(str.size());
+            for (char c : str)
+            {
+                switch (c)
+                {
+                    case '<':
+                        res += "&lt;";
+                        break;
+                    case '>':
+                        res += "&gt;";
+                        break;
+                    case '&':
+                        res += "&amp;";
+                        break;
+                    case '"':
+                        res += "&quot;";
+                        break;
+                    default:
+                        res += c;
+                }
+            }
+            return res;
+        }
+    }
+}
+
+#endif
@@ -11,17 +11,36 @@
 #define XCPP_MIME_HPP
 
 #include <complex>
+#include <cstddef>
+#include <iterator>
 #include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
 
 #include <cling/Interpreter/RuntimePrintValue.h>
 
 #include "nlohmann/json.hpp"
 
+#include "xdisplay_budget.hpp"
+
 namespace nl = nlohmann;
 
 namespace xcpp
 {
 
+    /**
+     * Whether the default text representation of a container of type T is
+     * summarized according to the display budget. Specialize it as
+     * std::false_type to display the container with cling::printValue
+     * instead. The specialization must be declared before a value of type T
+     * is first displayed.
+     */
+    template <class T>
+    struct summarize_repr : std::true_type
+    {
+    };
+
     namespace detail
     {
 
@@ -39,6 +58,171 @@ namespace xcpp
             return bundle;
         }
 
+        // std::void_t is C++17, this header is declared at the standard of
+        // the kernel.
+        template <class... T>
+        struct make_void
+        {
+            using type = void;
+        };
+
+        template <class... T>
+        using void_t = typename make_void<T...>::type;
+
+        template <class T, class = void>
+        struct is_container : std::false_type
+        {
+        };
+
+        template <class T>
+        struct is_container<
+            T,
+            void_t<
+                typename T::value_type,
+                decltype(std::declval<const T&>().size()),
+                decltype(std::declval<const T&>().begin()),
+                decltype(std::declval<const T&>().end())>> : std::true_type
+        {
+        };
+
+        // Strings and string views, of any character type, are printed as a
+        // whole.
+        template <class T, class = void>
+        struct is_string : std::false_type
+        {
+        };
+
+        template <class T>
+        struct is_string<T, void_t<typename T::traits_type>> : std::true_type
+        {
+        };
+
+        // Containers whose representation is summarized according to the
+        // display budget, unless summarize_repr opts them out.
+        template <class T, bool = is_container<T>::value && !is_string<T>::value>
+        struct is_summarizable : std::false_type
+        {
+        };
+
+        template <class T>
+        struct is_summarizable<T, true> : std::integral_constant<bool, summarize_repr<T>::value>
+        {
+        };
+
+        template <class T, class = void>
+        struct is_map : std::false_type
+        {
+        };
+
+        template <class T>
+        struct is_map<T, void_t<typename T::key_type, typename T::mapped_type>> : std::true_type
+        {
+        };
+
+        template <class T>
+        std::string repr_text(const T& value, std::size_t depth);
+
+        // Same layout as cling::printValue.
+        template <class E>
+        std::string repr_element(const E& element, std::size_t depth, std::true_type /*is_map*/)
+        {
+            return repr_text(element.first, depth) + " => " + repr_text(element.second, depth);
+        }
+
+        template <class E>
+        std::string repr_element(const E& element, std::size_t depth, std::false_type /*is_map*/)
+        {
+            return repr_text(element, depth);
+        }
+
+        // Taking the value_type converts proxies, as the ones of
+        // std::vector<bool>.
+        template <class C>
+        std::string repr_element(const typename C::value_type& element, std::size_t depth)
+        {
+            return repr_element(element, depth, is_map<C>());
+        }
+
+        template <class C>
+        void repr_tail(const C& value, std::size_t depth, std::string& res, std::true_type /*bidirectional*/)
+        {
+            const display_budget& budget = get_display_budget();
+            auto tail = std::prev(value.end(), static_cast<std::ptrdiff_t>(budget.edge_items));
+            for (std::size_t i = 0; i < budget.edge_items && res.size() <= budget.max_bytes; ++i, ++tail)
+            {
+                res += ", ";
+                res += repr_element<C>(*tail, depth + 1);
+            }
+        }
+
+        // Walking to the tail of a forward-only container would cost as much
+        // as printing it.
+        template <class C>
+        void repr_tail(const C&, std::size_t, std::string&, std::false_type /*bidirectional*/)
+        {
+        }
+
+        template <class T>
+        std::string repr_text(const T& value, std::size_t depth, std::true_type /*is_summarizable*/)
+        {
+            const display_budget& budget = get_display_budget();
+            if (depth >= budget.max_depth)
+            {
+                return "{ ... }";
+            }
+            std::size_t size = value.size();
+            if (size == 0)
+            {
+                return "{}";
+            }
+
+            bool summarize = size > budget.max_elements && size > 2 * budget.edge_items;
+            std::size_t head = summarize ? budget.edge_items : size;
+            std::string res = "{ ";
+            auto it = value.begin();
+            for (std::size_t i = 0; i < head && res.size() <= budget.max_bytes; ++i, ++it)
+            {
+                res += i == 0 ? "" : ", ";
+                res += repr_element<T>(*it, depth + 1);
+            }
+            if (summarize)
+            {
+                res += ", ...";
+                using category = typename std::iterator_traits<decltype(it)>::iterator_category;
+                repr_tail(value, depth, res, std::is_base_of<std::bidirectional_iterator_tag, category>());
+                return res + " } (" + std::to_string(size) + " elements)";
+            }
+            return res + " }";
+        }
+
+        template <class T>
+        std::string repr_text(const T& value, std::size_t /*depth*/, std::false_type /*is_summarizable*/)
+        {
+            return cling::printValue(&value);
+        }
+
+        template <class T>
+        std::string repr_text(const T& value, std::size_t depth)
+        {
+            return repr_text(value, depth, is_summarizable<T>());
+        }
+
+        // Cuts a text representation to the byte budget.
+        inline std::string truncate_repr(std::string text)
+        {
+            std::size_t max_bytes = get_display_budget().max_bytes;
+            if (text.size() > max_bytes)
+            {
+                // Do not cut a UTF-8 sequence.
+                while (max_bytes != 0 && (static_cast<unsigned char>(text[max_bytes]) & 0xC0) == 0x80)
+                {
+                    --max_bytes;
+                }
+                text.resize(max_bytes);
+                text += "...";
+            }
+            return text;
+        }
     }
 
     // Default implementation of mime_bundle_repr
@@ -46,7 +230,7 @@ namespace xcpp
     nl::json mime_bundle_repr(const T& value)
     {
         auto bundle = nl::json::object();
-        bundle["text/plain"] = cling::printValue(&value);
+        bundle["text/plain"] = detail::truncate_repr(detail::repr_text(value, 0));
         return bundle;
     }
 
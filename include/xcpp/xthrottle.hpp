@@ -0,0 +1,279 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_THROTTLE_HPP
+#define XCPP_THROTTLE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+
+#include "xeus-cling/xeus_cling_config.hpp"
+
+#include "xdisplay.hpp"
+#include "xhtml.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    namespace detail
+    {
+        // Keeps factory as the latest value of the display, which is
+        // published at most once per interval by the kernel.
+        XEUS_CLING_API void throttle_display(
+            const std::string& display_id,
+            std::function<nl::json()> factory,
+            std::chrono::steady_clock::duration interval
+        );
+
+        // Publishes the latest value of the display now, and forgets the
+        // display if release is true.
+        XEUS_CLING_API void flush_display(const std::string& display_id, bool release);
+
+        inline std::string new_display_id()
+        {
+            std::random_device rd;
+            std::mt19937_64 gen((std::uint64_t(rd()) << 32) ^ rd());
+            char buf[33];
+            std::snprintf(
+                buf,
+                sizeof(buf),
+                "%016llx%016llx",
+                static_cast<unsigned long long>(gen()),
+                static_cast<unsigned long long>(gen())
+            );
+            return buf;
+        }
+
+        // Computes the representation of a copy of the value, a lambda
+        // with an init-capture would require C++14.
+        template <class T>
+        struct repr_factory
+        {
+            T value;
+
+            nl::json operator()() const
+            {
+                using ::xcpp::mime_bundle_repr;
+                return mime_bundle_repr(value);
+            }
+        };
+
+        inline std::chrono::steady_clock::duration frame_interval(double max_fps)
+        {
+            return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(max_fps > 0. ? 1. / max_fps : 0.)
+            );
+        }
+    }
+
+    /**
+     * Display updated at most max_fps times per second, whatever the number
+     * of calls to update. Only the latest value is kept, and its mime bundle
+     * is computed when it is published, by the interpreter thread of the
+     * kernel: at a call to update once the interval has elapsed, at the end
+     * of the cell, and when the handle is destroyed or flushed. The values
+     * given by other threads are published at the next of these calls on
+     * the interpreter thread.
+     */
+    class throttled_display
+    {
+    public:
+
+        explicit throttled_display(double max_fps = 10.)
+            : throttled_display(detail::new_display_id(), max_fps)
+        {
+        }
+
+        throttled_display(std::string display_id, double max_fps)
+            : m_display_id(std::move(display_id))
+            , m_interval(detail::frame_interval(max_fps))
+        {
+        }
+
+        ~throttled_display()
+        {
+            detail::flush_display(m_display_id, true);
+        }
+
+        throttled_display(const throttled_display&) = delete;
+        throttled_display& operator=(const throttled_display&) = delete;
+
+        const std::string& display_id() const
+        {
+            return m_display_id;
+        }
+
+        std::chrono::steady_clock::duration interval() const
+        {
+            return m_interval;
+        }
+
+        // The value is copied, or moved, until it is published.
+        template <class T>
+        void update(T value)
+        {
+            detail::throttle_display(m_display_id, detail::repr_factory<T>{std::move(value)}, m_interval);
+        }
+
+        void flush()
+        {
+            detail::flush_display(m_display_id, false);
+        }
+
+    private:
+
+        std::string m_display_id;
+        std::chrono::steady_clock::duration m_interval;
+    };
+
+    /************
+     * progress *
+     ************/
+
+    struct progress_state
+    {
+        std::string description;
+        std::size_t value;
+        std::size_t total;
+        double elapsed;
+    };
+
+    inline nl::json mime_bundle_repr(const progress_state& state)
+    {
+        constexpr std::size_t width = 30;
+        double ratio = state.total != 0 ? static_cast<double>(state.value) / state.total : 1.;
+        ratio = ratio > 1. ? 1. : ratio;
+        std::size_t filled = static_cast<std::size_t>(ratio * width);
+        unsigned seconds = static_cast<unsigned>(state.elapsed);
+
+        char counts[96];
+        std::snprintf(
+            counts,
+            sizeof(counts),
+            "%3d%% %zu/%zu [%02u:%02u]",
+            static_cast<int>(ratio * 100),
+            state.value,
+            state.total,
+            seconds / 60,
+            seconds % 60
+        );
+        std::string prefix = state.description.empty() ? "" : state.description + ": ";
+        std::string html_prefix = state.description.empty() ? ""
+                                                             : detail::html_escape(state.description) + ": ";
+
+        auto bundle = nl::json::object();
+        bundle["text/plain"] = prefix + "|" + std::string(filled, '#') + std::string(width - filled, ' ') + "| "
+                               + counts;
+        bundle["text/html"] = "<div>" + html_prefix + "<progress value=\"" + std::to_string(state.value)
+                              + "\" max=\"" + std::to_string(state.total) + "\"></progress> " + counts
+                              + "</div>";
+        return bundle;
+    }
+
+    /**
+     * Progress bar displayed with a throttled_display, so that it can be
+     * advanced in tight loops:
+     *
+     *     xcpp::progress bar(n, "computing");
+     *     for (std::size_t i = 0; i < n; ++i)
+     *     {
+     *         ...
+     *         ++bar;
+     *     }
+     */
+    class progress
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+
+        explicit progress(std::size_t total, std::string description = "", double max_fps = 10.)
+            : m_display(max_fps)
+            , m_description(std::move(description))
+            , m_value(0)
+            , m_total(total)
+            , m_start(clock_type::now())
+            , m_last_update(m_start)
+        {
+            refresh();
+        }
+
+        ~progress()
+        {
+            refresh();
+        }
+
+        progress& operator++()
+        {
+            advance(1);
+            return *this;
+        }
+
+        void advance(std::size_t count)
+        {
+            set(m_value + count);
+        }
+
+        void set(std::size_t value)
+        {
+            m_value = value;
+            // Skip handing values to the kernel faster than it publishes
+            // them, but never miss the last one.
+            auto now = clock_type::now();
+            if (now - m_last_update >= m_display.interval() || m_value >= m_total)
+            {
+                m_last_update = now;
+                refresh();
+            }
+        }
+
+        std::size_t value() const
+        {
+            return m_value;
+        }
+
+        std::size_t total() const
+        {
+            return m_total;
+        }
+
+        // Publishes the current value now.
+        void flush()
+        {
+            refresh();
+            m_display.flush();
+        }
+
+    private:
+
+        void refresh()
+        {
+            std::chrono::duration<double> elapsed = clock_type::now() - m_start;
+            m_display.update(progress_state{m_description, m_value, m_total, elapsed.count()});
+        }
+
+        throttled_display m_display;
+        std::string m_description;
+        std::size_t m_value;
+        std::size_t m_total;
+        clock_type::time_point m_start;
+        clock_type::time_point m_last_update;
+    };
+}
+
+#endif
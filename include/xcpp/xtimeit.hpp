@@ -0,0 +1,127 @@
+/****************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay          *
+ * Copyright (c) 2016, QuantStack                                           *
+ *                                                                          *
+ * Distributed under the terms of the BSD 3-Clause License.                 *
+ *                                                                          *
+ * The full license is in the file LICENSE, distributed with this software. *
+ ****************************************************************************/
+
+#ifndef XCPP_TIMEIT_HPP
+#define XCPP_TIMEIT_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    // Formats a duration in seconds with the most suitable unit.
+    inline std::string format_timespan(double timespan, std::size_t precision = 3)
+    {
+        static const char* units[] = {"s", "ms", "us", "ns"};
+        static const double scaling[] = {1, 1e3, 1e6, 1e9};
+        int order = 3;
+        if (timespan > 0.0)
+        {
+            order = std::min(-static_cast<int>(std::floor(std::floor(std::log10(timespan)) / 3)), 3);
+            order = std::max(order, 0);
+        }
+        std::ostringstream output;
+        output.precision(static_cast<std::streamsize>(precision));
+        output << timespan * scaling[order] << " " << units[order];
+        return output.str();
+    }
+
+    /**
+     * Result of %timeit, stored in the _timeit_result variable of the
+     * notebook when the -o option is given. Times are per loop, in seconds.
+     */
+    struct timeit_result
+    {
+        std::size_t loops = 0;
+        std::size_t repeat = 0;
+        std::vector<double> all_runs;
+        double best = 0.;
+        double worst = 0.;
+        double mean = 0.;
+        double stdev = 0.;
+        double median = 0.;
+        double p95 = 0.;
+        // Settings of %benchenv and state of the machine during the runs.
+        std::string environment;
+    };
+
+    namespace detail
+    {
+        // Nearest-rank percentile of sorted values, p in [0, 1].
+        inline double percentile(const std::vector<double>& sorted, double p)
+        {
+            if (sorted.empty())
+            {
+                return 0.;
+            }
+            std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+            return sorted[rank == 0 ? 0 : rank - 1];
+        }
+
+        inline double median(const std::vector<double>& sorted)
+        {
+            if (sorted.empty())
+            {
+                return 0.;
+            }
+            std::size_t n = sorted.size();
+            return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+        }
+    }
+
+    inline timeit_result make_timeit_result(std::size_t loops, std::vector<double> all_runs)
+    {
+        timeit_result res;
+        res.loops = loops;
+        res.repeat = all_runs.size();
+        res.all_runs = std::move(all_runs);
+        if (res.all_runs.empty())
+        {
+            return res;
+        }
+
+        std::vector<double> sorted = res.all_runs;
+        std::sort(sorted.begin(), sorted.end());
+        res.best = sorted.front();
+        res.worst = sorted.back();
+        res.median = detail::median(sorted);
+        res.p95 = detail::percentile(sorted, 0.95);
+        for (double t : sorted)
+        {
+            res.mean += t;
+        }
+        res.mean /= sorted.size();
+        for (double t : sorted)
+        {
+            res.stdev += (t - res.mean) * (t - res.mean);
+        }
+        res.stdev = std::sqrt(res.stdev / sorted.size());
+        return res;
+    }
+
+    inline nl::json mime_bundle_repr(const timeit_result& res)
+    {
+        auto bundle = nl::json::object();
+        bundle["text/plain"] = "<TimeitResult : " + format_timespan(res.mean) + " +- " + format_timespan(res.stdev)
+                               + " per loop (mean +- std. dev. of " + std::to_string(res.repeat) + " runs, "
+                               + std::to_string(res.loops) + " loops each)>";
+        return bundle;
+    }
+}
+
+#endif
@@ -10,67 +10,267 @@
 #ifndef XCPP_MESSAGING_BUFFER_HPP
 #define XCPP_MESSAGING_BUFFER_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <streambuf>
 #include <string>
+#include <thread>
 
 namespace xcpp
 {
+    /****************
+     * flush policy *
+     ****************/
+
+    /**
+     * What a writer does when the output ring is full: either it makes room
+     * by collecting the pending output itself, or it discards its write.
+     * Discarded bytes are reported with the next message.
+     */
+    enum class xoverflow_policy
+    {
+        block,
+        discard
+    };
+
+    /**
+     * Controls how an xoutput_buffer turns writes into published messages.
+     *
+     * With a zero interval, every flush publishes immediately. Otherwise a
+     * background thread coalesces the output, which is published at most
+     * once per interval, or earlier when max_bytes are pending (0 means no
+     * byte threshold). Pending output is held in a ring of the given
+     * capacity.
+     * When tag_threads is set, lines written by threads other than the one
+     * which created the buffer are prefixed with the index of the thread.
+     * The output of a cell is limited to cell_max_bytes and
+     * cell_max_messages (0 means no limit), see xoutput_buffer::begin_cell.
+     */
+    struct xflush_policy
+    {
+        using duration_type = std::chrono::milliseconds;
+
+        duration_type interval = duration_type(0);
+        std::size_t max_bytes = 0;
+        std::size_t capacity = std::size_t(1) << 20;
+        xoverflow_policy overflow = xoverflow_policy::block;
+        bool tag_threads = false;
+        std::size_t cell_max_bytes = 0;
+        std::size_t cell_max_messages = 0;
+    };
+
+    /**
+     * What was published and spilled by an xoutput_buffer during a cell.
+     */
+    struct xcell_output
+    {
+        std::size_t bytes = 0;
+        std::size_t messages = 0;
+        std::size_t spilled_bytes = 0;
+    };
+
+    /***************
+     * output ring *
+     ***************/
+
+    /**
+     * Bounded lock-free multi-producer single-consumer byte ring.
+     *
+     * The ring is made of fixed-size slots carrying a sequence number, as in
+     * Vyukov's bounded queue. A write reserves all the consecutive slots it
+     * needs with a single CAS, so that it is never interleaved with another
+     * write, then fills and commits them. The consumer reads the committed
+     * slots in order.
+     */
+    class xoutput_ring
+    {
+    public:
+
+        explicit xoutput_ring(std::size_t capacity);
+
+        xoutput_ring(const xoutput_ring&) = delete;
+        xoutput_ring& operator=(const xoutput_ring&) = delete;
+
+        // Maximum number of bytes a single write may hold.
+        std::size_t capacity() const;
+
+        // Upper bound of the number of bytes waiting for the consumer.
+        std::size_t pending() const;
+        bool empty() const;
+
+        // Returns false when there is not enough room, in which case
+        // nothing is written. count must not exceed capacity().
+        bool try_write(const char* s, std::size_t count);
+
+        // Appends the committed bytes to output. Must not be called
+        // concurrently.
+        std::size_t read(std::string& output);
+
+    private:
+
+        static constexpr std::size_t slot_size = 64;
+        static constexpr std::size_t payload_size = slot_size - 2 * sizeof(std::size_t);
+
+        struct alignas(slot_size) slot
+        {
+            std::atomic<std::size_t> sequence;
+            std::size_t size;
+            char data[payload_size];
+        };
+
+        std::unique_ptr<slot[]> m_slots;
+        std::size_t m_mask;
+        alignas(slot_size) std::atomic<std::size_t> m_write_pos;
+        alignas(slot_size) std::atomic<std::size_t> m_read_pos;
+    };
+
+    /******************
+     * output staging *
+     ******************/
+
+    namespace detail
+    {
+        // Output written by a thread to an xoutput_buffer and not committed
+        // yet.
+        struct xoutput_staging
+        {
+            std::size_t buffer_id;
+            std::string data;
+            bool line_start;
+        };
+
+        // The stagings of a thread, one per buffer it has written to. What
+        // is left when the thread exits is committed. A deque keeps the
+        // stagings in place when a nested write to another buffer, from a
+        // publish callback, adds one. The stagings of destroyed buffers are
+        // released, and reused, at the next write of the thread once the
+        // number of destroyed buffers has changed.
+        struct xoutput_stagings
+        {
+            ~xoutput_stagings();
+
+            std::deque<xoutput_staging> stagings;
+            std::size_t generation = 0;
+        };
+    }
+
     /********************
      * output streambuf *
      ********************/
 
+    /**
+     * Streambuf publishing the output written to std::cout and std::cerr.
+     *
+     * Each thread stages its output in a thread-local buffer, which is
+     * committed to an xoutput_ring at line boundaries, so that lines written
+     * concurrently are never interleaved. Writers never take a lock. Partial
+     * lines of a thread are committed when it flushes the stream or exits.
+     *
+     * The callback is only called by the thread which created the buffer,
+     * the interpreter thread of the kernel, since the messages of the
+     * kernel are sent by that thread. The committed output is collected by
+     * a background thread, or by the other writers when the ring is full,
+     * and handed over to the owner thread, which publishes it at its next
+     * flush point: when it writes to the buffer, flushes it, or polls it.
+     */
     class xoutput_buffer : public std::streambuf
     {
     public:
 
         using base_type = std::streambuf;
         using callback_type = std::function<void(const std::string&)>;
+        using spill_type = std::function<void(const char*, std::size_t)>;
         using traits_type = base_type::traits_type;
+        using clock_type = std::chrono::steady_clock;
 
-        xoutput_buffer(callback_type callback)
-            : m_callback(std::move(callback))
-        {
-        }
+        xoutput_buffer(callback_type callback, xflush_policy policy = xflush_policy());
+        ~xoutput_buffer() override;
+
+        const xflush_policy& policy() const;
+
+        // Commits the output staged by the calling thread, and publishes the
+        // pending output synchronously, regardless of the policy. Used at the
+        // end of an execution so that the output is attached to the right
+        // request. On other threads than the owner, the output is only
+        // collected.
+        void flush();
+
+        // Publishes the output collected by the background thread, if any.
+        // Does nothing on other threads than the owner.
+        void poll();
+
+        // Starts accounting the published output against the cell budget of
+        // the policy. Once it is exhausted, the output is handed to spill
+        // instead of being published.
+        void begin_cell(spill_type spill = spill_type());
+
+        // Publishes the pending output and stops accounting.
+        xcell_output end_cell();
 
     protected:
 
-        traits_type::int_type overflow(traits_type::int_type c) override
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            // Called for each output character.
-            if (!traits_type::eq_int_type(c, traits_type::eof()))
-            {
-                m_output.push_back(traits_type::to_char_type(c));
-            }
-            return c;
-        }
+        traits_type::int_type overflow(traits_type::int_type c) override;
+        std::streamsize xsputn(const char* s, std::streamsize count) override;
+        traits_type::int_type sync() override;
 
-        std::streamsize xsputn(const char* s, std::streamsize count) override
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            // Called for a string of characters.
-            m_output.append(s, count);
-            return count;
-        }
+    private:
 
-        traits_type::int_type sync() override
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            // Called in case of flush.
-            if (!m_output.empty())
-            {
-                m_callback(m_output);
-                m_output.clear();
-            }
-            return 0;
-        }
+        friend struct detail::xoutput_stagings;
+
+        using registry_type = std::map<std::size_t, xoutput_buffer*>;
+
+        static std::size_t new_id();
+        static std::size_t thread_index();
+        static std::mutex& registry_mutex();
+        static registry_type& registry();
+        static std::atomic<std::size_t>& destroyed_buffers();
+        static detail::xoutput_stagings& thread_stagings();
+        static void prune(detail::xoutput_stagings& local);
+        static void commit_orphan(detail::xoutput_staging& st);
+
+        detail::xoutput_staging& staging();
+        void write(const char* s, std::size_t count);
+        void commit_staging(detail::xoutput_staging& st, std::size_t count);
+        void commit(const char* s, std::size_t count);
+        bool is_owner() const;
+        void collect();
+        void append(const std::string& output);
+        void publish();
+        std::size_t cell_allowance(const std::string& output) const;
+        bool threshold_reached(std::size_t size) const;
+        void run();
+
+        // Thread-local data is committed when it holds a line, or when it
+        // reaches this size.
+        static constexpr std::size_t staging_size = std::size_t(1) << 16;
 
         callback_type m_callback;
-        std::string m_output;
+        xflush_policy m_policy;
+        std::size_t m_id;
+        std::thread::id m_owner;
+        xoutput_ring m_ring;
+        std::atomic<std::size_t> m_discarded;
+        // Set when m_batch holds output to publish.
+        std::atomic<bool> m_ready;
+        // Guarded by m_collect_mutex.
+        std::string m_batch;
+        bool m_in_cell;
+        spill_type m_spill;
+        xcell_output m_cell_output;
+        bool m_stop;
         std::mutex m_mutex;
+        std::mutex m_collect_mutex;
+        std::condition_variable m_cv;
+        std::thread m_collector;
     };
 
     /*******************
@@ -123,6 +323,570 @@ namespace xcpp
             return c;
         }
     };
+
+    /***********************************
+     * xoutput_stagings implementation *
+     ***********************************/
+
+    namespace detail
+    {
+        inline xoutput_stagings::~xoutput_stagings()
+        {
+            for (auto& st : stagings)
+            {
+                if (!st.data.empty())
+                {
+                    xoutput_buffer::commit_orphan(st);
+                }
+            }
+        }
+    }
+
+    /*******************************
+     * xoutput_ring implementation *
+     *******************************/
+
+    inline xoutput_ring::xoutput_ring(std::size_t capacity)
+        : m_mask(0)
+        , m_write_pos(0)
+        , m_read_pos(0)
+    {
+        std::size_t slots = 1;
+        while (slots * payload_size < capacity)
+        {
+            slots *= 2;
+        }
+        m_slots.reset(new slot[slots]);
+        m_mask = slots - 1;
+        for (std::size_t i = 0; i < slots; ++i)
+        {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::size_t xoutput_ring::capacity() const
+    {
+        return (m_mask + 1) * payload_size;
+    }
+
+    inline std::size_t xoutput_ring::pending() const
+    {
+        std::size_t write_pos = m_write_pos.load(std::memory_order_relaxed);
+        std::size_t read_pos = m_read_pos.load(std::memory_order_relaxed);
+        return write_pos > read_pos ? (write_pos - read_pos) * payload_size : 0;
+    }
+
+    inline bool xoutput_ring::empty() const
+    {
+        return pending() == 0;
+    }
+
+    inline bool xoutput_ring::try_write(const char* s, std::size_t count)
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+        std::size_t nslots = (count + payload_size - 1) / payload_size;
+        std::size_t pos = m_write_pos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            // The consumer frees the slots in order, so the reservation
+            // fits if its last slot is free.
+            std::size_t last = pos + nslots - 1;
+            std::size_t seq = m_slots[last & m_mask].sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq - last);
+            if (diff == 0)
+            {
+                if (m_write_pos.compare_exchange_weak(pos, pos + nslots, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = m_write_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        for (std::size_t i = 0; i < nslots; ++i)
+        {
+            slot& sl = m_slots[(pos + i) & m_mask];
+            std::size_t size = std::min(count, payload_size);
+            std::memcpy(sl.data, s, size);
+            sl.size = size;
+            sl.sequence.store(pos + i + 1, std::memory_order_release);
+            s += size;
+            count -= size;
+        }
+        return true;
+    }
+
+    inline std::size_t xoutput_ring::read(std::string& output)
+    {
+        std::size_t pos = m_read_pos.load(std::memory_order_relaxed);
+        std::size_t res = 0;
+        while (true)
+        {
+            slot& sl = m_slots[pos & m_mask];
+            if (sl.sequence.load(std::memory_order_acquire) != pos + 1)
+            {
+                break;
+            }
+            output.append(sl.data, sl.size);
+            res += sl.size;
+            sl.sequence.store(pos + m_mask + 1, std::memory_order_release);
+            ++pos;
+            m_read_pos.store(pos, std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    /*********************************
+     * xoutput_buffer implementation *
+     *********************************/
+
+    inline xoutput_buffer::xoutput_buffer(callback_type callback, xflush_policy policy)
+        : m_callback(std::move(callback))
+        , m_policy(policy)
+        , m_id(new_id())
+        , m_owner(std::this_thread::get_id())
+        , m_ring(policy.capacity)
+        , m_discarded(0)
+        , m_ready(false)
+        , m_batch()
+        , m_in_cell(false)
+        , m_spill()
+        , m_cell_output()
+        , m_stop(false)
+    {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            registry()[m_id] = this;
+        }
+        if (m_policy.interval.count() > 0)
+        {
+            m_collector = std::thread(&xoutput_buffer::run, this);
+        }
+    }
+
+    inline xoutput_buffer::~xoutput_buffer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex());
+            registry().erase(m_id);
+        }
+        ++destroyed_buffers();
+        if (m_collector.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_collector.join();
+        }
+    }
+
+    inline const xflush_policy& xoutput_buffer::policy() const
+    {
+        return m_policy;
+    }
+
+    inline void xoutput_buffer::flush()
+    {
+        detail::xoutput_staging& st = staging();
+        commit_staging(st, st.data.size());
+        if (is_owner())
+        {
+            publish();
+        }
+        else
+        {
+            collect();
+        }
+    }
+
+    inline void xoutput_buffer::poll()
+    {
+        if (m_ready.load(std::memory_order_acquire) && is_owner())
+        {
+            publish();
+        }
+    }
+
+    inline void xoutput_buffer::begin_cell(spill_type spill)
+    {
+        std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+        m_in_cell = true;
+        m_spill = std::move(spill);
+        m_cell_output = xcell_output();
+    }
+
+    inline xcell_output xoutput_buffer::end_cell()
+    {
+        flush();
+        std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+        m_in_cell = false;
+        m_spill = spill_type();
+        return m_cell_output;
+    }
+
+    inline auto xoutput_buffer::overflow(traits_type::int_type c) -> traits_type::int_type
+    {
+        // Called for each output character.
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            char ch = traits_type::to_char_type(c);
+            write(&ch, 1);
+        }
+        return c;
+    }
+
+    inline std::streamsize xoutput_buffer::xsputn(const char* s, std::streamsize count)
+    {
+        // Called for a string of characters.
+        write(s, static_cast<std::size_t>(count));
+        return count;
+    }
+
+    inline auto xoutput_buffer::sync() -> traits_type::int_type
+    {
+        // Called in case of flush. The background thread, if any, takes
+        // care of the pending output at its next deadline.
+        detail::xoutput_staging& st = staging();
+        commit_staging(st, st.data.size());
+        if (!m_collector.joinable())
+        {
+            flush();
+        }
+        else
+        {
+            poll();
+        }
+        return 0;
+    }
+
+    inline std::size_t xoutput_buffer::new_id()
+    {
+        static std::atomic<std::size_t> counter(0);
+        return ++counter;
+    }
+
+    inline std::size_t xoutput_buffer::thread_index()
+    {
+        static std::atomic<std::size_t> counter(0);
+        thread_local std::size_t index = ++counter;
+        return index;
+    }
+
+    inline std::mutex& xoutput_buffer::registry_mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    inline auto xoutput_buffer::registry() -> registry_type&
+    {
+        static registry_type buffers;
+        return buffers;
+    }
+
+    inline std::atomic<std::size_t>& xoutput_buffer::destroyed_buffers()
+    {
+        static std::atomic<std::size_t> counter(0);
+        return counter;
+    }
+
+    inline detail::xoutput_stagings& xoutput_buffer::thread_stagings()
+    {
+        thread_local detail::xoutput_stagings stagings;
+        return stagings;
+    }
+
+    inline void xoutput_buffer::prune(detail::xoutput_stagings& local)
+    {
+        // The stagings are not erased, an outer write may still refer to
+        // one of them. Buffer ids start at 1, 0 marks a free staging.
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        for (auto& st : local.stagings)
+        {
+            if (st.buffer_id != 0 && registry().find(st.buffer_id) == registry().end())
+            {
+                st.buffer_id = 0;
+                std::string().swap(st.data);
+            }
+        }
+    }
+
+    inline void xoutput_buffer::commit_orphan(detail::xoutput_staging& st)
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex());
+        auto it = registry().find(st.buffer_id);
+        if (it != registry().end())
+        {
+            it->second->commit_staging(st, st.data.size());
+        }
+    }
+
+    inline detail::xoutput_staging& xoutput_buffer::staging()
+    {
+        detail::xoutput_stagings& local = thread_stagings();
+        std::size_t generation = destroyed_buffers().load(std::memory_order_relaxed);
+        if (local.generation != generation)
+        {
+            prune(local);
+            local.generation = generation;
+        }
+        detail::xoutput_staging* free_staging = nullptr;
+        for (auto& st : local.stagings)
+        {
+            if (st.buffer_id == m_id)
+            {
+                return st;
+            }
+            if (st.buffer_id == 0 && free_staging == nullptr)
+            {
+                free_staging = &st;
+            }
+        }
+        if (free_staging != nullptr)
+        {
+            free_staging->buffer_id = m_id;
+            free_staging->line_start = true;
+            return *free_staging;
+        }
+        local.stagings.push_back({m_id, std::string(), true});
+        return local.stagings.back();
+    }
+
+    inline void xoutput_buffer::write(const char* s, std::size_t count)
+    {
+        detail::xoutput_staging& st = staging();
+        st.data.append(s, count);
+
+        // Commit up to the last complete line.
+        std::size_t end = st.data.size();
+        std::size_t begin = end - count;
+        while (end != begin && st.data[end - 1] != '\n')
+        {
+            --end;
+        }
+        if (end != begin)
+        {
+            commit_staging(st, end);
+        }
+        else if (st.data.size() >= std::min(staging_size, m_ring.capacity()))
+        {
+            commit_staging(st, st.data.size());
+        }
+    }
+
+    inline void xoutput_buffer::commit_staging(detail::xoutput_staging& st, std::size_t count)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        if (!m_policy.tag_threads || std::this_thread::get_id() == m_owner)
+        {
+            commit(st.data.data(), count);
+        }
+        else
+        {
+            std::string tag = "[thread " + std::to_string(thread_index()) + "] ";
+            std::string chunk;
+            chunk.reserve(count + tag.size());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (st.line_start)
+                {
+                    chunk += tag;
+                }
+                chunk += st.data[i];
+                st.line_start = st.data[i] == '\n';
+            }
+            commit(chunk.data(), chunk.size());
+        }
+        st.data.erase(0, count);
+    }
+
+    inline void xoutput_buffer::commit(const char* s, std::size_t count)
+    {
+        while (count != 0)
+        {
+            std::size_t size = std::min(count, m_ring.capacity());
+            std::size_t pending = m_ring.pending();
+            while (!m_ring.try_write(s, size))
+            {
+                if (m_policy.overflow == xoverflow_policy::discard)
+                {
+                    m_discarded += count;
+                    return;
+                }
+                // Backpressure: make room from the writing thread.
+                collect();
+            }
+            if (m_collector.joinable()
+                && (pending == 0 || (!threshold_reached(pending) && threshold_reached(pending + size))))
+            {
+                m_cv.notify_one();
+            }
+            s += size;
+            count -= size;
+        }
+        poll();
+    }
+
+    inline bool xoutput_buffer::is_owner() const
+    {
+        return std::this_thread::get_id() == m_owner;
+    }
+
+    inline void xoutput_buffer::collect()
+    {
+        std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+        std::string output;
+        m_ring.read(output);
+        std::size_t discarded = m_discarded.exchange(0);
+        if (discarded != 0)
+        {
+            output += "\n[" + std::to_string(discarded) + " bytes of output discarded]\n";
+        }
+        if (!output.empty())
+        {
+            append(output);
+        }
+    }
+
+    inline void xoutput_buffer::append(const std::string& output)
+    {
+        if (!m_in_cell)
+        {
+            // Between cells, the output of the threads still running waits
+            // for the next flush point of the owner, up to the byte budget
+            // of a cell.
+            if (m_policy.cell_max_bytes != 0 && !m_batch.empty()
+                && m_batch.size() + output.size() > m_policy.cell_max_bytes)
+            {
+                m_discarded += output.size();
+                return;
+            }
+            m_batch += output;
+            m_ready.store(true, std::memory_order_release);
+            return;
+        }
+
+        // Output appended to a batch is published in the same message.
+        std::size_t allowed = cell_allowance(output);
+        if (allowed != 0)
+        {
+            if (m_batch.empty())
+            {
+                ++m_cell_output.messages;
+            }
+            m_cell_output.bytes += allowed;
+            m_batch.append(output, 0, allowed);
+            m_ready.store(true, std::memory_order_release);
+        }
+        if (allowed != output.size())
+        {
+            m_cell_output.spilled_bytes += output.size() - allowed;
+            if (m_spill)
+            {
+                m_spill(output.data() + allowed, output.size() - allowed);
+            }
+        }
+    }
+
+    inline void xoutput_buffer::publish()
+    {
+        collect();
+        std::string batch;
+        {
+            std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+            batch.swap(m_batch);
+            m_ready.store(false, std::memory_order_relaxed);
+        }
+        if (!batch.empty())
+        {
+            m_callback(batch);
+        }
+    }
+
+    inline std::size_t xoutput_buffer::cell_allowance(const std::string& output) const
+    {
+        if (m_cell_output.spilled_bytes != 0
+            || (m_policy.cell_max_messages != 0 && m_batch.empty()
+                && m_cell_output.messages >= m_policy.cell_max_messages))
+        {
+            return 0;
+        }
+        if (m_policy.cell_max_bytes == 0
+            || m_cell_output.bytes + output.size() <= m_policy.cell_max_bytes)
+        {
+            return output.size();
+        }
+        // Cut after the last complete line if possible, and never in the
+        // middle of a UTF-8 sequence.
+        std::size_t allowed = m_policy.cell_max_bytes - std::min(m_cell_output.bytes, m_policy.cell_max_bytes);
+        if (allowed == 0)
+        {
+            return 0;
+        }
+        std::size_t line_end = output.rfind('\n', allowed - 1);
+        if (line_end != std::string::npos)
+        {
+            return line_end + 1;
+        }
+        while (allowed != 0 && (static_cast<unsigned char>(output[allowed]) & 0xC0) == 0x80)
+        {
+            --allowed;
+        }
+        return allowed;
+    }
+
+    inline bool xoutput_buffer::threshold_reached(std::size_t size) const
+    {
+        return m_policy.max_bytes != 0 && size >= m_policy.max_bytes;
+    }
+
+    inline void xoutput_buffer::run()
+    {
+        auto deadline = clock_type::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stop)
+        {
+            if (m_ring.empty())
+            {
+                // Writers do not take the lock to notify, hence the timeout.
+                m_cv.wait_for(lock, m_policy.interval);
+                continue;
+            }
+            // Coalesce everything written until the deadline, unless the
+            // byte threshold is reached first.
+            m_cv.wait_until(
+                lock,
+                deadline,
+                [this]()
+                {
+                    return m_stop || threshold_reached(m_ring.pending());
+                }
+            );
+            if (m_stop)
+            {
+                break;
+            }
+            lock.unlock();
+            collect();
+            lock.lock();
+            deadline = clock_type::now() + m_policy.interval;
+        }
+    }
 }
 
 #endif
@@ -10,8 +10,11 @@
 #ifndef XEUS_CLING_INTERPRETER_HPP
 #define XEUS_CLING_INTERPRETER_HPP
 
+#include <memory>
+#include <mutex>
 #include <streambuf>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cling/Interpreter/Interpreter.h"
@@ -29,6 +32,13 @@ namespace nl = nlohmann;
 
 namespace xcpp
 {
+    class display_throttler;
+    class fd_capture;
+    class jitdump_writer;
+    struct optimization_settings;
+    class phase_timer;
+    class spill_file;
+
     class XEUS_CLING_API interpreter : public xeus::xinterpreter
     {
     public:
@@ -39,6 +49,21 @@ namespace xcpp
         void publish_stdout(const std::string&);
         void publish_stderr(const std::string&);
 
+        // Captures the output written by native code directly to the file
+        // descriptors 1 and 2, in addition to std::cout and std::cerr.
+        void capture_fds();
+
+        // Writes the functions compiled by the JIT in the jitdump format of
+        // perf, from the perf map written by cling.
+        void enable_jitdump();
+
+        // Thread-safe counterparts of display_data and update_display_data.
+        // The displays of other threads than the interpreter thread are
+        // published at its next display, or at the end of the cell.
+        void publish_display_data(nl::json data, nl::json metadata, nl::json transient, bool update);
+
+        display_throttler& get_display_throttler();
+
     private:
 
         void configure_impl() override;
@@ -52,6 +77,10 @@ namespace xcpp
             bool allow_stdin
         ) override;
 
+        // Runs code which is not a magic, publishes its result or its error,
+        // and returns the content of the reply.
+        nl::json execute_code(int execution_counter, const std::string& code, bool silent);
+
         nl::json complete_request_impl(const std::string& code, int cursor_pos) override;
 
         nl::json inspect_request_impl(const std::string& code, int cursor_pos, int detail_level) override;
@@ -70,6 +99,13 @@ namespace xcpp
 
         void redirect_output();
         void restore_output();
+        void flush_output();
+        void begin_cell_output(int execution_counter);
+        void end_cell_output();
+        // Called on the interpreter thread only.
+        void flush_displays();
+        void send_display_data(nl::json data, nl::json metadata, nl::json transient, bool update);
+        void publish_pending_output();
 
         void init_extra_includes();
         void init_libs();
@@ -90,6 +126,46 @@ namespace xcpp
 
         xoutput_buffer m_cout_buffer;
         xoutput_buffer m_cerr_buffer;
+
+        std::unique_ptr<fd_capture> p_stdout_capture;
+        std::unique_ptr<fd_capture> p_stderr_capture;
+
+        // Receives the output of the current cell past its budget.
+        std::unique_ptr<spill_file> p_spill;
+
+        std::unique_ptr<display_throttler> p_display_throttler;
+
+        // The messages of the kernel are sent by the interpreter thread, the
+        // displays of the other threads wait for it.
+        struct deferred_display
+        {
+            nl::json data;
+            nl::json metadata;
+            nl::json transient;
+            bool update;
+        };
+
+        std::thread::id m_interpreter_thread;
+        std::mutex m_display_mutex;
+        std::vector<deferred_display> m_deferred_displays;
+
+        std::unique_ptr<jitdump_writer> p_jitdump;
+
+        // Time spent in each phase of the current execute request.
+        std::unique_ptr<phase_timer> p_phase_timer;
+        int m_execution_counter;
+        bool m_silent;
+
+        // Reply to the code of a cell run by a magic such as %%timing, which
+        // replaces the reply of the magics manager.
+        nl::json m_cell_res;
+
+        // Code generation settings of the current cell, set by %%optimize.
+        std::unique_ptr<optimization_settings> p_cell_optimization;
+
+        // Set by %memit --always, adds the memory used by each cell to the
+        // execute replies.
+        bool m_track_memory;
     };
 }
 
@@ -7,6 +7,7 @@
  * The full license is in the file LICENSE, distributed with this software.         *
  ************************************************************************************/
 
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -80,17 +81,48 @@ std::string extract_filename(int *argc, char* argv[])
     return res;
 }
 
+bool extract_flag(int *argc, char* argv[], const std::string& flag)
+{
+    for (int i = 0; i < *argc; ++i)
+    {
+        if (std::string(argv[i]) == flag)
+        {
+            for (int j = i; j < *argc - 1; ++j)
+            {
+                argv[j] = argv[j + 1];
+            }
+            *argc -= 1;
+            return true;
+        }
+    }
+    return false;
+}
+
 using interpreter_ptr = std::unique_ptr<xcpp::interpreter>;
 
-interpreter_ptr build_interpreter(int argc, char** argv)
+interpreter_ptr build_interpreter(int argc, char** argv, bool perf_map)
 {
-    int interpreter_argc = argc + 1;
+    // The JIT of cling writes the map of the functions it compiles for perf
+    // when this variable is set at its creation.
+    if (perf_map)
+    {
+#ifdef _WIN32
+        _putenv_s("CLING_PROFILE", "1");
+#else
+        setenv("CLING_PROFILE", "1", 1);
+#endif
+    }
+
+    int interpreter_argc = argc + 2;
     const char** interpreter_argv = new const char*[interpreter_argc];
     interpreter_argv[0] = "xeus-cling";
+    // The sampler of %%prun walks the stack through the frame pointers.
+    // Being first, this flag can be overridden by the arguments of the kernel.
+    interpreter_argv[1] = "-fno-omit-frame-pointer";
     // Copy all arguments in the new array excepting the process name.
     for (int i = 1; i < argc; i++)
     {
-        interpreter_argv[i] = argv[i];
+        interpreter_argv[i + 1] = argv[i];
     }
     std::string include_dir = std::string(LLVM_DIR) + std::string("/include");
     interpreter_argv[interpreter_argc - 1] = include_dir.c_str();
@@ -129,8 +161,20 @@ int main(int argc, char* argv[])
     signal(SIGINT, stop_handler);
 
     std::string file_name = extract_filename(&argc, argv);
+    bool capture_fds = extract_flag(&argc, argv, "--capture-fds");
+    bool perf_map = extract_flag(&argc, argv, "--perf-map");
+    bool jitdump = extract_flag(&argc, argv, "--jitdump");
 
-    interpreter_ptr interpreter = build_interpreter(argc, argv);
+    // The jitdump is made from the perf map.
+    interpreter_ptr interpreter = build_interpreter(argc, argv, perf_map || jitdump);
+    if (capture_fds)
+    {
+        interpreter->capture_fds();
+    }
+    if (jitdump)
+    {
+        interpreter->enable_jitdump();
+    }
 
     auto context = xeus::make_context<zmq::context_t>();
 
@@ -0,0 +1,199 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+// Replaceable operators new and delete of the xcpp executable. Being
+// defined in the executable, they are also the ones called by the shared
+// libraries, so that %%allocprof sees the allocations made by precompiled
+// code called by the cells. They forward the allocations to the active
+// allocation recorder, which only checks that it is running and that the
+// interpreter runs user code.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <stdlib.h>
+
+#include "xalloc_recorder.hpp"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+
+namespace
+{
+    void* allocate(std::size_t size)
+    {
+        if (size == 0)
+        {
+            size = 1;
+        }
+        void* res = nullptr;
+        while ((res = std::malloc(size)) == nullptr)
+        {
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+        return res;
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment)
+    {
+        std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+        if (size == 0)
+        {
+            size = 1;
+        }
+        void* res = nullptr;
+        while (::posix_memalign(&res, align, size) != 0)
+        {
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+        return res;
+    }
+
+    template <class... A>
+    void* allocate_nothrow(std::size_t size, A... alignment) noexcept
+    {
+        try
+        {
+            return allocate(size, alignment...);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    void* res = allocate(size);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* res = allocate(size);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    void* res = allocate_nothrow(size);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    void* res = allocate_nothrow(size);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    void* res = allocate(size, alignment);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    void* res = allocate(size, alignment);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    void* res = allocate_nothrow(size, alignment);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    void* res = allocate_nothrow(size, alignment);
+    xcpp::record_operator_new(res, size, __builtin_return_address(0));
+    return res;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
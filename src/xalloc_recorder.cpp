@@ -0,0 +1,440 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define XCPP_HAS_BACKTRACE
+#include <execinfo.h>
+#endif
+
+#include "cling/Interpreter/Interpreter.h"
+#include "cling/Interpreter/InterpreterCallbacks.h"
+
+#include "llvm/Support/DynamicLibrary.h"
+
+#include "xalloc_recorder.hpp"
+
+namespace xcpp
+{
+    // Slots for the frames of the recorder and of the redirected function.
+    constexpr std::size_t hook_frames = 6;
+
+    std::string size_class_name(std::size_t size_class)
+    {
+        if (size_class + 1 >= allocation_size_classes)
+        {
+            return "> 4 MiB";
+        }
+        std::size_t size = std::size_t(16) << size_class;
+        if (size < 1024)
+        {
+            return "<= " + std::to_string(size) + " B";
+        }
+        if (size < 1024 * 1024)
+        {
+            return "<= " + std::to_string(size / 1024) + " KiB";
+        }
+        return "<= " + std::to_string(size / (1024 * 1024)) + " MiB";
+    }
+
+    static std::size_t size_class(std::size_t size)
+    {
+        std::size_t res = 0;
+        std::size_t limit = 16;
+        while (size > limit && res + 1 < allocation_size_classes)
+        {
+            limit *= 2;
+            ++res;
+        }
+        return res;
+    }
+
+    /**********************
+     * Redirected symbols *
+     **********************/
+
+#ifdef XCPP_HAS_BACKTRACE
+    static std::atomic<allocation_recorder*> active_recorder(nullptr);
+    // Number of redirected calls which may be using the active recorder.
+    static std::atomic<int> recording_hooks(0);
+    // Set while the recorder runs on the thread, its own allocations are
+    // not recorded.
+    static thread_local bool in_hook = false;
+    // Nesting of the user code run by the interpreter on the thread, and
+    // whether the thread is in a redirected operator new called by the JIT,
+    // which records the allocation itself.
+    static thread_local int user_code_depth = 0;
+    static thread_local bool in_jit_new = false;
+
+    struct jit_new_scope
+    {
+        jit_new_scope()
+        {
+            in_jit_new = true;
+        }
+
+        ~jit_new_scope()
+        {
+            in_jit_new = false;
+        }
+    };
+
+    static void record_allocation(void* ptr, std::size_t size, void* caller)
+    {
+        if (ptr == nullptr || in_hook || active_recorder.load(std::memory_order_relaxed) == nullptr)
+        {
+            return;
+        }
+        in_hook = true;
+        // The recorder is read after the count is incremented, so stop,
+        // which resets it before waiting for the count to drop to zero,
+        // cannot return while it is in use.
+        recording_hooks.fetch_add(1, std::memory_order_seq_cst);
+        allocation_recorder* recorder = active_recorder.load(std::memory_order_seq_cst);
+        if (recorder != nullptr)
+        {
+            recorder->record(size, caller);
+        }
+        recording_hooks.fetch_sub(1, std::memory_order_release);
+        in_hook = false;
+    }
+
+    static void* malloc_jit(std::size_t size)
+    {
+        void* res = std::malloc(size);
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* calloc_jit(std::size_t count, std::size_t size)
+    {
+        void* res = std::calloc(count, size);
+        record_allocation(res, count * size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* realloc_jit(void* ptr, std::size_t size)
+    {
+        void* res = std::realloc(ptr, size);
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_jit(std::size_t size)
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new(size);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_array_jit(std::size_t size)
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new[](size);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_nothrow_jit(std::size_t size, const std::nothrow_t& tag) noexcept
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new(size, tag);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_array_nothrow_jit(std::size_t size, const std::nothrow_t& tag) noexcept
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new[](size, tag);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_aligned_jit(std::size_t size, std::align_val_t alignment)
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new(size, alignment);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_array_aligned_jit(std::size_t size, std::align_val_t alignment)
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new[](size, alignment);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_aligned_nothrow_jit(
+        std::size_t size,
+        std::align_val_t alignment,
+        const std::nothrow_t& tag
+    ) noexcept
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new(size, alignment, tag);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+
+    static void* new_array_aligned_nothrow_jit(
+        std::size_t size,
+        std::align_val_t alignment,
+        const std::nothrow_t& tag
+    ) noexcept
+    {
+        void* res = nullptr;
+        {
+            jit_new_scope scope;
+            res = ::operator new[](size, alignment, tag);
+        }
+        record_allocation(res, size, __builtin_return_address(0));
+        return res;
+    }
+#endif
+
+    bool install_allocation_hooks()
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        static bool installed = false;
+        if (!installed)
+        {
+            // Itanium mangling of the operators new, std::size_t is
+            // unsigned long (m) or unsigned int (j).
+            const std::string size = sizeof(std::size_t) == sizeof(unsigned long) ? "m" : "j";
+            const std::string nothrow = "RKSt9nothrow_t";
+            const std::string aligned = "St11align_val_t";
+            llvm::sys::DynamicLibrary::AddSymbol("malloc", (void*) &malloc_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("calloc", (void*) &calloc_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("realloc", (void*) &realloc_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Znw" + size, (void*) &new_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Zna" + size, (void*) &new_array_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Znw" + size + nothrow, (void*) &new_nothrow_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Zna" + size + nothrow, (void*) &new_array_nothrow_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Znw" + size + aligned, (void*) &new_aligned_jit);
+            llvm::sys::DynamicLibrary::AddSymbol("_Zna" + size + aligned, (void*) &new_array_aligned_jit);
+            llvm::sys::DynamicLibrary::AddSymbol(
+                "_Znw" + size + aligned + nothrow,
+                (void*) &new_aligned_nothrow_jit
+            );
+            llvm::sys::DynamicLibrary::AddSymbol(
+                "_Zna" + size + aligned + nothrow,
+                (void*) &new_array_aligned_nothrow_jit
+            );
+            installed = true;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void record_operator_new(void* ptr, std::size_t size, void* caller)
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        if (user_code_depth > 0 && !in_jit_new)
+        {
+            record_allocation(ptr, size, caller);
+        }
+#else
+        (void) ptr;
+        (void) size;
+        (void) caller;
+#endif
+    }
+
+#ifdef XCPP_HAS_BACKTRACE
+    namespace
+    {
+        class user_code_callbacks : public cling::InterpreterCallbacks
+        {
+        public:
+
+            explicit user_code_callbacks(cling::Interpreter* interpreter)
+                : cling::InterpreterCallbacks(interpreter)
+            {
+            }
+
+            void* EnteringUserCode() override
+            {
+                ++user_code_depth;
+                return nullptr;
+            }
+
+            void ReturnedFromUserCode(void*) override
+            {
+                --user_code_depth;
+            }
+        };
+    }
+#endif
+
+    void install_allocation_callbacks(cling::Interpreter& interpreter)
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        interpreter.setCallbacks(std::make_unique<user_code_callbacks>(&interpreter));
+#else
+        (void) interpreter;
+#endif
+    }
+
+    /*****************************************
+     * Implementation of allocation_recorder *
+     *****************************************/
+
+    allocation_recorder::allocation_recorder(std::size_t max_depth)
+        : m_max_depth(max_depth)
+        , m_total()
+        , m_size_classes()
+        , m_stacks()
+        , m_frames(max_depth + hook_frames, nullptr)
+        , m_mutex()
+        , m_running(false)
+        , m_message()
+    {
+    }
+
+    allocation_recorder::~allocation_recorder()
+    {
+        stop();
+    }
+
+    bool allocation_recorder::start()
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        if (!install_allocation_hooks())
+        {
+            m_message = "allocations cannot be recorded on this platform";
+            return false;
+        }
+        // The first call to backtrace loads the unwinder, which allocates.
+        void* warmup[4];
+        ::backtrace(warmup, 4);
+
+        allocation_recorder* expected = nullptr;
+        if (!active_recorder.compare_exchange_strong(expected, this))
+        {
+            m_message = "another allocation profiler is running";
+            return false;
+        }
+        m_running = true;
+        return true;
+#else
+        m_message = "allocations cannot be recorded on this platform";
+        return false;
+#endif
+    }
+
+    void allocation_recorder::stop()
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        if (!m_running)
+        {
+            return;
+        }
+        active_recorder.store(nullptr, std::memory_order_seq_cst);
+        // The redirected calls which read the recorder before it was reset
+        // may still be recording, the recorder must outlive them.
+        while (recording_hooks.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+        m_running = false;
+#endif
+    }
+
+    const allocation_stats& allocation_recorder::total() const
+    {
+        return m_total;
+    }
+
+    auto allocation_recorder::size_classes() const
+        -> const std::array<allocation_stats, allocation_size_classes>&
+    {
+        return m_size_classes;
+    }
+
+    auto allocation_recorder::stacks() const -> const stack_map&
+    {
+        return m_stacks;
+    }
+
+    const std::string& allocation_recorder::message() const
+    {
+        return m_message;
+    }
+
+    void allocation_recorder::record(std::size_t size, void* caller)
+    {
+#ifdef XCPP_HAS_BACKTRACE
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_total.count;
+        m_total.bytes += size;
+        allocation_stats& size_stats = m_size_classes[size_class(size)];
+        ++size_stats.count;
+        size_stats.bytes += size;
+
+        // The stack starts at the return address of the redirected
+        // function, whatever was inlined in it.
+        int depth = ::backtrace(m_frames.data(), static_cast<int>(m_frames.size()));
+        auto first = m_frames.begin();
+        auto last = m_frames.begin() + depth;
+        auto end = std::min(last, first + hook_frames);
+        auto it = std::find(first, end, caller);
+        std::vector<void*> stack;
+        if (it == end)
+        {
+            stack.push_back(caller);
+        }
+        else
+        {
+            stack.assign(it, std::min(last, it + static_cast<std::ptrdiff_t>(m_max_depth)));
+        }
+        allocation_stats& stack_stats = m_stacks[stack];
+        ++stack_stats.count;
+        stack_stats.bytes += size;
+#else
+        (void) size;
+        (void) caller;
+#endif
+    }
+}
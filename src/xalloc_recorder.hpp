@@ -0,0 +1,111 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_ALLOC_RECORDER_HPP
+#define XCPP_ALLOC_RECORDER_HPP
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "xeus-cling/xeus_cling_config.hpp"
+
+namespace cling
+{
+    class Interpreter;
+}
+
+namespace xcpp
+{
+    struct allocation_stats
+    {
+        std::size_t count = 0;
+        std::size_t bytes = 0;
+    };
+
+    // Powers of two from 16 B to 4 MiB, and the larger sizes.
+    constexpr std::size_t allocation_size_classes = 20;
+
+    // "<= 16 B", "<= 32 B", ..., "> 4 MiB"
+    std::string size_class_name(std::size_t size_class);
+
+    /**
+     * Redirects malloc, calloc, realloc and the replaceable operators new
+     * called by the code compiled by the JIT after this call, so that their
+     * calls can be recorded. When no recorder is running, the redirected
+     * functions only check it and forward to the original ones. The calls
+     * to malloc made by the loaded libraries are not redirected. Returns
+     * false on platforms where the allocations cannot be recorded.
+     */
+    bool install_allocation_hooks();
+
+    /**
+     * Lets the operators new of the xcpp executable record the allocations
+     * made while the interpreter runs user code. These also see the
+     * allocations of the precompiled code of the libraries, such as the
+     * instantiations of std::string of the standard library, but not the
+     * ones of the compilation of the cells.
+     */
+    void install_allocation_callbacks(cling::Interpreter& interpreter);
+
+    // Called by the operators new of the xcpp executable.
+    XEUS_CLING_API void record_operator_new(void* ptr, std::size_t size, void* caller);
+
+    /**
+     * Counts the allocations made by the code compiled by the JIT between
+     * start and stop, by size class and by call stack, and the ones made
+     * with the operators new of xcpp by the thread running the cells.
+     * Only one recorder can run at a time.
+     */
+    class allocation_recorder
+    {
+    public:
+
+        using stack_map = std::map<std::vector<void*>, allocation_stats>;
+
+        explicit allocation_recorder(std::size_t max_depth);
+        ~allocation_recorder();
+
+        allocation_recorder(const allocation_recorder&) = delete;
+        allocation_recorder& operator=(const allocation_recorder&) = delete;
+
+        // Returns false, with the reason in message(), if recording cannot
+        // start.
+        bool start();
+        void stop();
+
+        const allocation_stats& total() const;
+        const std::array<allocation_stats, allocation_size_classes>& size_classes() const;
+
+        // Return addresses of the call stacks, innermost frame first, from
+        // the caller of the allocation function.
+        const stack_map& stacks() const;
+
+        const std::string& message() const;
+
+        // Called by the redirected functions, with their return address.
+        void record(std::size_t size, void* caller);
+
+    private:
+
+        std::size_t m_max_depth;
+        allocation_stats m_total;
+        std::array<allocation_stats, allocation_size_classes> m_size_classes;
+        stack_map m_stacks;
+        std::vector<void*> m_frames;
+        std::mutex m_mutex;
+        bool m_running;
+        std::string m_message;
+    };
+}
+
+#endif
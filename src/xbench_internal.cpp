@@ -0,0 +1,235 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include "xbench_internal.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xparser.hpp"
+
+namespace xcpp
+{
+    std::size_t parse_size(const std::string& str)
+    {
+        std::size_t pos = 0;
+        std::size_t value = std::stoull(str, &pos);
+        std::string suffix = trim(str.substr(pos));
+        unsigned int shift = 0;
+        if (suffix == "K" || suffix == "k")
+        {
+            shift = 10;
+        }
+        else if (suffix == "M")
+        {
+            shift = 20;
+        }
+        else if (suffix == "G")
+        {
+            shift = 30;
+        }
+        else if (!suffix.empty())
+        {
+            throw std::invalid_argument("invalid size: " + str);
+        }
+        if (value > (std::numeric_limits<std::size_t>::max() >> shift))
+        {
+            throw std::out_of_range("size too large: " + str);
+        }
+        return value << shift;
+    }
+
+    std::vector<std::size_t> parse_parameter(const std::string& spec, std::string& name)
+    {
+        std::size_t eq = spec.find('=');
+        if (eq == std::string::npos)
+        {
+            throw std::invalid_argument("expected NAME=VALUES, got " + spec);
+        }
+        name = trim(spec.substr(0, eq));
+        std::string values = spec.substr(eq + 1);
+
+        std::vector<std::size_t> res;
+        std::size_t dots = values.find("..");
+        if (dots == std::string::npos)
+        {
+            std::istringstream iss(values);
+            std::string value;
+            while (std::getline(iss, value, ','))
+            {
+                if (!trim(value).empty())
+                {
+                    res.push_back(parse_size(trim(value)));
+                }
+            }
+        }
+        else
+        {
+            std::string last = values.substr(dots + 2);
+            std::size_t factor = 8;
+            std::size_t colon = last.find(':');
+            if (colon != std::string::npos)
+            {
+                factor = parse_size(last.substr(colon + 1));
+                last = last.substr(0, colon);
+            }
+            std::size_t first_value = parse_size(trim(values.substr(0, dots)));
+            std::size_t last_value = parse_size(trim(last));
+            if (factor < 2 || first_value == 0 || first_value > last_value)
+            {
+                throw std::invalid_argument("invalid range: " + values);
+            }
+            for (std::size_t value = first_value; value < last_value; value *= factor)
+            {
+                res.push_back(value);
+                // The next value would be past the bound, and may not fit
+                // in a size_t.
+                if (value > last_value / factor)
+                {
+                    break;
+                }
+            }
+            res.push_back(last_value);
+        }
+        if (name.empty() || res.empty())
+        {
+            throw std::invalid_argument("invalid parameter: " + spec);
+        }
+        return res;
+    }
+
+    double mann_whitney(const std::vector<double>& x, const std::vector<double>& y)
+    {
+        std::size_t n1 = x.size();
+        std::size_t n2 = y.size();
+        if (n1 == 0 || n2 == 0)
+        {
+            return 1.;
+        }
+
+        std::vector<std::pair<double, std::size_t>> all;
+        all.reserve(n1 + n2);
+        for (double v : x)
+        {
+            all.emplace_back(v, 0);
+        }
+        for (double v : y)
+        {
+            all.emplace_back(v, 1);
+        }
+        std::sort(all.begin(), all.end());
+
+        double rank_sum = 0.;
+        double tie_term = 0.;
+        for (std::size_t i = 0; i < all.size();)
+        {
+            std::size_t j = i;
+            while (j < all.size() && all[j].first == all[i].first)
+            {
+                ++j;
+            }
+            double rank = (i + j + 1) / 2.;
+            for (std::size_t k = i; k < j; ++k)
+            {
+                if (all[k].second == 0)
+                {
+                    rank_sum += rank;
+                }
+            }
+            double t = static_cast<double>(j - i);
+            tie_term += t * t * t - t;
+            i = j;
+        }
+
+        double n = static_cast<double>(n1 + n2);
+        double u = rank_sum - n1 * (n1 + 1) / 2.;
+        double mu = n1 * n2 / 2.;
+        double sigma = std::sqrt(n1 * n2 / 12. * ((n + 1) - tie_term / (n * (n - 1))));
+        if (sigma == 0.)
+        {
+            return 1.;
+        }
+        double z = std::max(std::abs(u - mu) - 0.5, 0.) / sigma;
+        return std::erfc(z / std::sqrt(2.));
+    }
+
+    bool is_identifier_char(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    std::vector<std::string> split_values(const std::string& list)
+    {
+        std::vector<std::string> res;
+        std::string current;
+        int depth = 0;
+        for (char c : list)
+        {
+            if (c == '(' || c == '[' || c == '{')
+            {
+                ++depth;
+            }
+            else if (c == ')' || c == ']' || c == '}')
+            {
+                --depth;
+            }
+            if (c == ',' && depth == 0)
+            {
+                res.push_back(trim(current));
+                current.clear();
+            }
+            else
+            {
+                current += c;
+            }
+        }
+        res.push_back(trim(current));
+        res.erase(std::remove(res.begin(), res.end(), std::string()), res.end());
+        return res;
+    }
+
+    bool parse_search_space(const std::string& line, tune_parameter& parameter)
+    {
+        std::string tline = trim(line);
+        std::size_t end = 0;
+        while (end < tline.size() && is_identifier_char(tline[end]))
+        {
+            ++end;
+        }
+        if (end == 0 || std::isdigit(static_cast<unsigned char>(tline[0])))
+        {
+            return false;
+        }
+        std::string rest = trim(tline.substr(end));
+        if (rest.compare(0, 2, "in") != 0)
+        {
+            return false;
+        }
+        rest = trim(rest.substr(2));
+        if (rest.size() < 2 || rest.front() != '{' || rest.back() != '}')
+        {
+            return false;
+        }
+        parameter.name = tline.substr(0, end);
+        parameter.values = split_values(rest.substr(1, rest.size() - 2));
+        if (parameter.values.empty())
+        {
+            throw std::invalid_argument("empty search space for " + parameter.name);
+        }
+        return true;
+    }
+}
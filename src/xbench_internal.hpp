@@ -0,0 +1,47 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_BENCH_INTERNAL_HPP
+#define XCPP_BENCH_INTERNAL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace xcpp
+{
+    // Parses "64", "4K", "16M" or "1G", with binary prefixes.
+    std::size_t parse_size(const std::string& str);
+
+    // Splits "N=1K..1M:8" or "N=1,2,4" into the name and the values of the
+    // parameter. Ranges are geometric, with a factor of 8 by default, and
+    // always include their bounds.
+    std::vector<std::size_t> parse_parameter(const std::string& spec, std::string& name);
+
+    // Two-sided p-value of the Mann-Whitney U test, with the normal
+    // approximation corrected for ties. It makes no assumption on the
+    // distribution of the timings, which are usually skewed by outliers.
+    double mann_whitney(const std::vector<double>& x, const std::vector<double>& y);
+
+    struct tune_parameter
+    {
+        std::string name;
+        std::vector<std::string> values;
+    };
+
+    bool is_identifier_char(char c);
+
+    // Splits "a, f(b, c), d" at the commas which are not nested.
+    std::vector<std::string> split_values(const std::string& list);
+
+    // Parses "NAME in {V1, V2, ...}", returns false if the line has
+    // another form and throws if the set of values is empty.
+    bool parse_search_space(const std::string& line, tune_parameter& parameter);
+}
+#endif
@@ -0,0 +1,627 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define XCPP_HAS_MXCSR
+#include <xmmintrin.h>
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+#define XCPP_HAS_FPCR
+#endif
+
+#include "xbenchenv.hpp"
+
+namespace xcpp
+{
+#if defined(XCPP_HAS_MXCSR)
+    // Flush-to-zero (bit 15) and denormals-are-zero (bit 6) of MXCSR.
+    constexpr unsigned int denormal_flags = 0x8040;
+#elif defined(XCPP_HAS_FPCR)
+    // Flush-to-zero (bit 24) of FPCR, which also applies to the inputs.
+    constexpr std::uint64_t denormal_flags = std::uint64_t(1) << 24;
+
+    static std::uint64_t read_fpcr()
+    {
+        std::uint64_t res;
+        asm volatile("mrs %0, fpcr" : "=r"(res));
+        return res;
+    }
+
+    static void write_fpcr(std::uint64_t value)
+    {
+        asm volatile("msr fpcr, %0" : : "r"(value));
+    }
+#endif
+
+    /******************
+     * Machine status *
+     ******************/
+
+    static std::string read_first_line(const std::string& path)
+    {
+        std::ifstream in(path);
+        std::string res;
+        std::getline(in, res);
+        while (!res.empty() && std::isspace(static_cast<unsigned char>(res.back())))
+        {
+            res.pop_back();
+        }
+        return res;
+    }
+
+    // Parses the list format of sysfs, such as "0-3,8".
+    static std::vector<int> parse_cpu_list(const std::string& list)
+    {
+        std::vector<int> res;
+        std::istringstream iss(list);
+        std::string range;
+        while (std::getline(iss, range, ','))
+        {
+            int first = 0;
+            int last = 0;
+            int count = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (count == 1)
+            {
+                res.push_back(first);
+            }
+            else if (count == 2)
+            {
+                for (int cpu = first; cpu <= last; ++cpu)
+                {
+                    res.push_back(cpu);
+                }
+            }
+        }
+        return res;
+    }
+
+    static std::string format_cpu_list(const std::vector<int>& cpus)
+    {
+        std::string res;
+        for (std::size_t i = 0; i < cpus.size();)
+        {
+            std::size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            {
+                ++j;
+            }
+            res += (res.empty() ? "" : ",") + std::to_string(cpus[i]);
+            if (j != i)
+            {
+                res += "-" + std::to_string(cpus[j]);
+            }
+            i = j + 1;
+        }
+        return res.empty() ? "none" : res;
+    }
+
+    static std::string cpu_path(int cpu, const std::string& file)
+    {
+        return "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/" + file;
+    }
+
+    static std::string governor(int cpu)
+    {
+        return read_first_line(cpu_path(cpu, "cpufreq/scaling_governor"));
+    }
+
+    // The other hardware threads of the core of the CPU.
+    static std::vector<int> smt_siblings(int cpu)
+    {
+        std::string list = read_first_line(cpu_path(cpu, "topology/thread_siblings_list"));
+        std::vector<int> res = parse_cpu_list(list);
+        res.erase(std::remove(res.begin(), res.end(), cpu), res.end());
+        return res;
+    }
+
+    // "enabled", "disabled" or an empty string if unknown.
+    static std::string turbo_status()
+    {
+        std::string no_turbo = read_first_line("/sys/devices/system/cpu/intel_pstate/no_turbo");
+        if (!no_turbo.empty())
+        {
+            return no_turbo == "0" ? "enabled" : "disabled";
+        }
+        std::string boost = read_first_line("/sys/devices/system/cpu/cpufreq/boost");
+        if (!boost.empty())
+        {
+            return boost == "1" ? "enabled" : "disabled";
+        }
+        return "";
+    }
+
+    // One-minute load average, negative if unknown.
+    static double load_average()
+    {
+        double res = -1.;
+        std::string line = read_first_line("/proc/loadavg");
+        if (!line.empty())
+        {
+            std::sscanf(line.c_str(), "%lf", &res);
+        }
+        return res;
+    }
+
+    static int online_cpus()
+    {
+#if defined(__linux__)
+        return static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+#else
+        return 0;
+#endif
+    }
+
+#if defined(__linux__)
+    static int thread_id()
+    {
+        return static_cast<int>(::syscall(SYS_gettid));
+    }
+
+    static std::vector<int> thread_ids()
+    {
+        std::vector<int> res;
+        DIR* dir = ::opendir("/proc/self/task");
+        if (dir == nullptr)
+        {
+            return res;
+        }
+        while (dirent* entry = ::readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                res.push_back(std::atoi(entry->d_name));
+            }
+        }
+        ::closedir(dir);
+        return res;
+    }
+
+    static std::vector<int> get_affinity(int tid)
+    {
+        std::vector<int> res;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (::sched_getaffinity(tid, sizeof(set), &set) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &set))
+                {
+                    res.push_back(cpu);
+                }
+            }
+        }
+        return res;
+    }
+
+    static bool set_affinity(int tid, const std::vector<int>& cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return ::sched_setaffinity(tid, sizeof(set), &set) == 0;
+    }
+#endif
+
+    /***************
+     * Noise probe *
+     ***************/
+
+    static long preemptions()
+    {
+#if defined(__linux__) && defined(RUSAGE_THREAD)
+        rusage usage;
+        if (::getrusage(RUSAGE_THREAD, &usage) == 0)
+        {
+            return usage.ru_nivcsw;
+        }
+#endif
+        return -1;
+    }
+
+    static double spin(std::size_t iterations)
+    {
+        using clock_type = std::chrono::steady_clock;
+        volatile double sink = 0.;
+        auto start = clock_type::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            sink = sink + 1.;
+        }
+        return std::chrono::duration<double>(clock_type::now() - start).count();
+    }
+
+    noise_measure noise_probe(std::size_t runs)
+    {
+        std::size_t iterations = 1000;
+        while (spin(iterations) < 1e-3 && iterations < (std::size_t(1) << 40))
+        {
+            iterations *= 2;
+        }
+
+        long preempted = preemptions();
+        std::vector<double> times;
+        for (std::size_t r = 0; r < std::max(runs, std::size_t(2)); ++r)
+        {
+            times.push_back(spin(iterations));
+        }
+        long after = preemptions();
+
+        noise_measure res;
+        double mean = 0.;
+        for (double t : times)
+        {
+            mean += t;
+        }
+        mean /= times.size();
+        double variance = 0.;
+        for (double t : times)
+        {
+            variance += (t - mean) * (t - mean);
+        }
+        res.variation = std::sqrt(variance / times.size()) / mean;
+        auto range = std::minmax_element(times.begin(), times.end());
+        res.spread = *range.second / *range.first;
+        res.preemptions = preempted < 0 || after < 0 ? -1 : after - preempted;
+        return res;
+    }
+
+    /***************************************
+     * Implementation of bench_environment *
+     ***************************************/
+
+    bench_environment::bench_environment()
+        : m_pinned_cpu(-1)
+        , m_configured(false)
+        , m_saved_affinities()
+    {
+    }
+
+    bool bench_environment::pin(int cpu, std::string& message)
+    {
+#if defined(__linux__)
+        int self = thread_id();
+        if (m_saved_affinities.empty())
+        {
+            for (int tid : thread_ids())
+            {
+                m_saved_affinities.emplace_back(tid, get_affinity(tid));
+            }
+        }
+        std::vector<int> allowed = get_affinity(self);
+        for (const auto& saved : m_saved_affinities)
+        {
+            if (saved.first == self)
+            {
+                allowed = saved.second;
+            }
+        }
+        if (allowed.empty())
+        {
+            message = "cannot read the affinity of the thread: " + std::string(std::strerror(errno));
+            return false;
+        }
+
+        if (cpu < 0)
+        {
+            // An isolated CPU if there is one, otherwise the last one, as
+            // the first ones handle more interrupts.
+            cpu = allowed.back();
+            for (int isolated : parse_cpu_list(read_first_line("/sys/devices/system/cpu/isolated")))
+            {
+                if (std::find(allowed.begin(), allowed.end(), isolated) != allowed.end())
+                {
+                    cpu = isolated;
+                }
+            }
+        }
+        if (std::find(allowed.begin(), allowed.end(), cpu) == allowed.end())
+        {
+            message = "CPU " + std::to_string(cpu) + " is not available to the kernel, which can use "
+                      + format_cpu_list(allowed);
+            return false;
+        }
+        if (!set_affinity(self, {cpu}))
+        {
+            message = "cannot pin the thread: " + std::string(std::strerror(errno));
+            return false;
+        }
+
+        // The other threads leave the core of the CPU, unless they have
+        // nowhere else to go. Threads which have exited are ignored.
+        std::vector<int> core = smt_siblings(cpu);
+        core.push_back(cpu);
+        for (const auto& saved : m_saved_affinities)
+        {
+            if (saved.first == self)
+            {
+                continue;
+            }
+            std::vector<int> others;
+            for (int other : saved.second)
+            {
+                if (std::find(core.begin(), core.end(), other) == core.end())
+                {
+                    others.push_back(other);
+                }
+            }
+            if (others.empty())
+            {
+                others = saved.second;
+                others.erase(std::remove(others.begin(), others.end(), cpu), others.end());
+            }
+            if (!others.empty())
+            {
+                set_affinity(saved.first, others);
+            }
+        }
+        m_pinned_cpu = cpu;
+        m_configured = true;
+        return true;
+#else
+        (void) cpu;
+        message = "pinning threads is only supported on Linux";
+        return false;
+#endif
+    }
+
+    void bench_environment::unpin()
+    {
+#if defined(__linux__)
+        for (const auto& saved : m_saved_affinities)
+        {
+            set_affinity(saved.first, saved.second);
+        }
+#endif
+        m_saved_affinities.clear();
+        m_pinned_cpu = -1;
+    }
+
+    int bench_environment::pinned_cpu() const
+    {
+        return m_pinned_cpu;
+    }
+
+    bool bench_environment::set_flush_denormals(bool enable)
+    {
+#if defined(XCPP_HAS_MXCSR)
+        unsigned int csr = _mm_getcsr();
+        _mm_setcsr(enable ? csr | denormal_flags : csr & ~denormal_flags);
+        m_configured = true;
+        return true;
+#elif defined(XCPP_HAS_FPCR)
+        std::uint64_t fpcr = read_fpcr();
+        write_fpcr(enable ? fpcr | denormal_flags : fpcr & ~denormal_flags);
+        m_configured = true;
+        return true;
+#else
+        (void) enable;
+        return false;
+#endif
+    }
+
+    bool bench_environment::flush_denormals() const
+    {
+#if defined(XCPP_HAS_MXCSR)
+        return (_mm_getcsr() & denormal_flags) == denormal_flags;
+#elif defined(XCPP_HAS_FPCR)
+        return (read_fpcr() & denormal_flags) != 0;
+#else
+        return false;
+#endif
+    }
+
+    bool bench_environment::configured() const
+    {
+        return m_configured;
+    }
+
+    int bench_environment::current_cpu() const
+    {
+#if defined(__linux__)
+        return ::sched_getcpu();
+#else
+        return -1;
+#endif
+    }
+
+    std::string bench_environment::describe() const
+    {
+        int cpu = m_pinned_cpu >= 0 ? m_pinned_cpu : current_cpu();
+        std::string res = m_pinned_cpu >= 0 ? "pinned to CPU " + std::to_string(cpu) : "not pinned";
+        res += std::string(", denormals ") + (flush_denormals() ? "flushed to zero" : "kept");
+        std::string gov = cpu >= 0 ? governor(cpu) : "";
+        if (!gov.empty())
+        {
+            res += ", governor " + gov;
+        }
+        std::string turbo = turbo_status();
+        if (!turbo.empty())
+        {
+            res += ", turbo " + turbo;
+        }
+        double load = load_average();
+        if (load >= 0.)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof(buf), ", load %.2f", load);
+            res += buf;
+        }
+        return res;
+    }
+
+    std::vector<std::string> bench_environment::warnings() const
+    {
+        std::vector<std::string> res;
+        int cpu = m_pinned_cpu >= 0 ? m_pinned_cpu : current_cpu();
+        if (m_pinned_cpu < 0)
+        {
+            res.push_back("the thread running the cells is not pinned, it may move between CPUs");
+        }
+        std::string gov = cpu >= 0 ? governor(cpu) : "";
+        if (!gov.empty() && gov != "performance")
+        {
+            res.push_back(
+                "CPU " + std::to_string(cpu) + " uses the " + gov
+                + " frequency governor, its frequency changes with the load"
+            );
+        }
+        if (turbo_status() == "enabled")
+        {
+            res.push_back("turbo boost is enabled, the frequency depends on the temperature and on the load");
+        }
+        if (m_pinned_cpu >= 0)
+        {
+            std::vector<int> siblings = smt_siblings(m_pinned_cpu);
+            if (!siblings.empty())
+            {
+                res.push_back(
+                    "CPU " + std::to_string(m_pinned_cpu) + " shares its core with CPU "
+                    + format_cpu_list(siblings) + " (SMT), where other processes may run"
+                );
+            }
+        }
+        double load = load_average();
+        int cpus = online_cpus();
+        if (load >= 0. && cpus > 0 && load > 0.75 * cpus)
+        {
+            char buf[128];
+            std::snprintf(
+                buf,
+                sizeof(buf),
+                "the load average is %.2f for %d CPUs, other processes compete for them",
+                load,
+                cpus
+            );
+            res.push_back(buf);
+        }
+        return res;
+    }
+
+    std::string bench_environment::report(const noise_measure& noise) const
+    {
+        std::ostringstream os;
+        auto row = [&os](const char* name, const std::string& value)
+        {
+            char buf[24];
+            std::snprintf(buf, sizeof(buf), "%-14s", name);
+            os << buf << value << "\n";
+        };
+
+        int cpu = m_pinned_cpu >= 0 ? m_pinned_cpu : current_cpu();
+#if defined(__linux__)
+        std::string allowed = format_cpu_list(get_affinity(thread_id()));
+#else
+        std::string allowed = "unknown";
+#endif
+        if (m_pinned_cpu >= 0)
+        {
+            row("thread", "pinned to CPU " + std::to_string(cpu) + ", the other threads moved off its core");
+        }
+        else
+        {
+            row("thread", "not pinned, running on CPU " + std::to_string(cpu) + " of " + allowed);
+        }
+        row("denormals", flush_denormals() ? "flushed to zero (FTZ/DAZ)" : "kept");
+        std::string gov = cpu >= 0 ? governor(cpu) : "";
+        row("governor", gov.empty() ? "unknown" : gov);
+        std::string turbo = turbo_status();
+        row("turbo", turbo.empty() ? "unknown" : turbo);
+        row("SMT siblings", cpu >= 0 ? format_cpu_list(smt_siblings(cpu)) : "unknown");
+        std::string isolated = read_first_line("/sys/devices/system/cpu/isolated");
+        row("isolated CPUs", format_cpu_list(parse_cpu_list(isolated)));
+        // The load averages over 1, 5 and 15 minutes.
+        double loads[3] = {0., 0., 0.};
+        std::string load = read_first_line("/proc/loadavg");
+        if (std::sscanf(load.c_str(), "%lf %lf %lf", &loads[0], &loads[1], &loads[2]) == 3)
+        {
+            char load_buf[64];
+            std::snprintf(load_buf, sizeof(load_buf), "%.2f %.2f %.2f", loads[0], loads[1], loads[2]);
+            row("load", std::string(load_buf) + " on " + std::to_string(online_cpus()) + " CPUs");
+        }
+        else
+        {
+            row("load", "unknown");
+        }
+
+        char buf[128];
+        std::snprintf(
+            buf,
+            sizeof(buf),
+            "%.1f%% variation between runs of a 1 ms loop, slowest %.2fx the fastest",
+            100. * noise.variation,
+            noise.spread
+        );
+        std::string measure = buf;
+        if (noise.preemptions >= 0)
+        {
+            measure += ", " + std::to_string(noise.preemptions) + " preemption"
+                       + (noise.preemptions == 1 ? "" : "s");
+        }
+        row("noise", measure);
+
+        std::vector<std::string> all = warnings();
+        if (noise.variation > 0.05 || noise.preemptions > 0)
+        {
+            all.push_back("a fixed loop is not timed consistently, other tasks interrupt the thread");
+        }
+        for (const auto& warning : all)
+        {
+            os << "\nwarning: " << warning;
+        }
+        return os.str();
+    }
+
+    bench_environment& get_bench_environment()
+    {
+        static bench_environment environment;
+        return environment;
+    }
+
+    void print_environment(const bench_environment& environment)
+    {
+        if (!environment.configured())
+        {
+            return;
+        }
+        std::cout << "environment: " << environment.describe() << "\n";
+        for (const auto& warning : environment.warnings())
+        {
+            std::cout << "warning: " << warning << "\n";
+        }
+        std::cout << std::flush;
+    }
+}
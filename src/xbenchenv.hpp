@@ -0,0 +1,93 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_BENCHENV_HPP
+#define XCPP_BENCHENV_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xcpp
+{
+    // Run-to-run variation of a fixed loop, measured by noise_probe.
+    struct noise_measure
+    {
+        // Standard deviation over mean, and largest run over smallest.
+        double variation = 0.;
+        double spread = 0.;
+        // Involuntary context switches of the thread during the runs, or
+        // -1 if unknown.
+        long preemptions = -1;
+    };
+
+    // Times a loop of about a millisecond the given number of times.
+    noise_measure noise_probe(std::size_t runs);
+
+    /**
+     * Settings of the thread running the cells which affect the stability
+     * of the measures: the CPU it is pinned to, away from the other threads
+     * of the kernel, and the flushing of denormal floating-point numbers
+     * to zero. Also reads the state of the machine (frequency governor,
+     * SMT siblings, load) to tell when measures are likely unreliable.
+     * Pinning is only supported on Linux.
+     */
+    class bench_environment
+    {
+    public:
+
+        bench_environment();
+
+        // Pins the calling thread to the given CPU, or to a chosen one if
+        // cpu is negative, and moves the other threads of the process to
+        // the other CPUs. Returns false with the reason in message.
+        bool pin(int cpu, std::string& message);
+        // Restores the affinities saved by the first call to pin.
+        void unpin();
+        int pinned_cpu() const;
+
+        // Sets the flush-to-zero and denormals-are-zero modes of the
+        // calling thread. Returns false if the platform has no such mode.
+        bool set_flush_denormals(bool enable);
+        bool flush_denormals() const;
+
+        // Whether any setting was changed, in which case the timing magics
+        // report the environment.
+        bool configured() const;
+
+        // One line summary, recorded with the results of the timing magics.
+        std::string describe() const;
+        // Reasons why the measures may be unreliable.
+        std::vector<std::string> warnings() const;
+        // Full report of the settings and of the machine.
+        std::string report(const noise_measure& noise) const;
+
+    private:
+
+        // CPU the calling thread last ran on.
+        int current_cpu() const;
+
+        int m_pinned_cpu;
+        bool m_configured;
+        // Thread ids and affinities before pinning, as lists of CPUs.
+        std::vector<std::pair<int, std::vector<int>>> m_saved_affinities;
+    };
+
+    // The environment of the kernel, shared by %benchenv and the timing
+    // magics.
+    bench_environment& get_bench_environment();
+
+    // Prints the environment after the results of the timing magics once
+    // %benchenv changed a setting, with the reasons why the measures may be
+    // unreliable.
+    void print_environment(const bench_environment& environment);
+}
+
+#endif
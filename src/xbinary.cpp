@@ -0,0 +1,121 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "xcpp/xbinary.hpp"
+
+namespace xcpp
+{
+    std::string base64_encode(bytes_view bytes)
+    {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        const unsigned char* in = static_cast<const unsigned char*>(bytes.data);
+        std::size_t size = bytes.size;
+        std::string res(4 * ((size + 2) / 3), '=');
+        char* out = &res[0];
+
+        std::size_t i = 0;
+        for (; i + 2 < size; i += 3)
+        {
+            std::uint32_t n = (std::uint32_t(in[i]) << 16) | (std::uint32_t(in[i + 1]) << 8) | in[i + 2];
+            *out++ = alphabet[(n >> 18) & 0x3F];
+            *out++ = alphabet[(n >> 12) & 0x3F];
+            *out++ = alphabet[(n >> 6) & 0x3F];
+            *out++ = alphabet[n & 0x3F];
+        }
+        // The padding is already in place.
+        if (i < size)
+        {
+            std::uint32_t n = std::uint32_t(in[i]) << 16;
+            if (i + 1 < size)
+            {
+                n |= std::uint32_t(in[i + 1]) << 8;
+            }
+            *out++ = alphabet[(n >> 18) & 0x3F];
+            *out++ = alphabet[(n >> 12) & 0x3F];
+            if (i + 1 < size)
+            {
+                *out++ = alphabet[(n >> 6) & 0x3F];
+            }
+        }
+        return res;
+    }
+
+    /*********************************
+     * Implementation of mapped_file *
+     *********************************/
+
+    mapped_file::mapped_file(const std::string& path)
+        : p_data(nullptr)
+        , m_size(0)
+        , m_mapped(false)
+        , m_content()
+    {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0)
+        {
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+            {
+                void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data != MAP_FAILED)
+                {
+                    p_data = static_cast<const char*>(data);
+                    m_size = static_cast<std::size_t>(st.st_size);
+                    m_mapped = true;
+                }
+            }
+            ::close(fd);
+        }
+        if (m_mapped)
+        {
+            return;
+        }
+#endif
+        // Empty and special files, or no mmap.
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("cannot read " + path);
+        }
+        m_content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        p_data = m_content.data();
+        m_size = m_content.size();
+    }
+
+    mapped_file::~mapped_file()
+    {
+#ifndef _WIN32
+        if (m_mapped)
+        {
+            ::munmap(const_cast<char*>(p_data), m_size);
+        }
+#endif
+    }
+
+    bytes_view mapped_file::bytes() const
+    {
+        return bytes_view(p_data, m_size);
+    }
+}
@@ -0,0 +1,153 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include "xcapture.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <mutex>
+#include <streambuf>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace xcpp
+{
+    /********************************
+     * Implementation of fd_capture *
+     ********************************/
+
+    // Size of the chunks read from the pipe. They are handed as is to the
+    // target streambuf, which copies them once into its output ring.
+    static constexpr std::size_t chunk_size = std::size_t(1) << 16;
+
+    fd_capture::fd_capture(int fd, std::streambuf& target)
+        : m_fd(fd)
+        , m_saved_fd(-1)
+        , m_read_fd(-1)
+        , m_target(target)
+        , m_stop(false)
+    {
+#ifndef _WIN32
+        int pipe_fds[2];
+        if (::pipe(pipe_fds) != 0)
+        {
+            return;
+        }
+        m_saved_fd = ::dup(m_fd);
+        if (m_saved_fd < 0 || ::dup2(pipe_fds[1], m_fd) < 0)
+        {
+            ::close(pipe_fds[0]);
+            ::close(pipe_fds[1]);
+            if (m_saved_fd >= 0)
+            {
+                ::close(m_saved_fd);
+                m_saved_fd = -1;
+            }
+            return;
+        }
+        // m_fd is now the only write end of the pipe, the reader gets EOF
+        // once it is restored.
+        ::close(pipe_fds[1]);
+        m_read_fd = pipe_fds[0];
+        ::fcntl(m_read_fd, F_SETFL, ::fcntl(m_read_fd, F_GETFL) | O_NONBLOCK);
+        ::fcntl(m_read_fd, F_SETFD, FD_CLOEXEC);
+        m_reader = std::thread(&fd_capture::run, this);
+#endif
+    }
+
+    fd_capture::~fd_capture()
+    {
+#ifndef _WIN32
+        if (!active())
+        {
+            return;
+        }
+        ::dup2(m_saved_fd, m_fd);
+        ::close(m_saved_fd);
+        // Child processes may still hold the write end of the pipe, so the
+        // reader may not get EOF.
+        m_stop = true;
+        m_reader.join();
+        forward_available();
+        ::close(m_read_fd);
+#endif
+    }
+
+    bool fd_capture::active() const
+    {
+        return m_read_fd >= 0;
+    }
+
+    void fd_capture::drain()
+    {
+        if (active())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            forward_available();
+        }
+    }
+
+    void fd_capture::run()
+    {
+#ifndef _WIN32
+        while (!m_stop)
+        {
+            pollfd pfd = {m_read_fd, POLLIN, 0};
+            int ret = ::poll(&pfd, 1, 100);
+            if (ret < 0 && errno != EINTR)
+            {
+                break;
+            }
+            if (ret <= 0)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (forward_available() == 0 && (pfd.revents & POLLHUP))
+            {
+                break;
+            }
+        }
+#endif
+    }
+
+    std::size_t fd_capture::forward_available()
+    {
+        std::size_t res = 0;
+#ifndef _WIN32
+        // Holding m_mutex, so that drain() returns only once the data read
+        // by the reader thread has been forwarded.
+        thread_local std::vector<char> chunk(chunk_size);
+        while (true)
+        {
+            ssize_t count = ::read(m_read_fd, chunk.data(), chunk.size());
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                break;
+            }
+            m_target.sputn(chunk.data(), count);
+            res += static_cast<std::size_t>(count);
+        }
+        if (res != 0)
+        {
+            m_target.pubsync();
+        }
+#endif
+        return res;
+    }
+}
@@ -0,0 +1,62 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_CAPTURE_HPP
+#define XCPP_CAPTURE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+
+namespace xcpp
+{
+    /**
+     * fd_capture redirects a file descriptor (1 or 2) to a pipe, so that the
+     * output written directly to it by native code (puts, fwrite, write(1,
+     * ...), Fortran runtimes, preloaded libraries) is forwarded to a
+     * streambuf by a reader thread. The target must not publish from the
+     * reader thread: an xoutput_buffer only collects the output written by
+     * other threads than its owner, which publishes it at its next flush
+     * point. The file descriptor is restored on destruction. This is a
+     * no-op on Windows.
+     */
+    class fd_capture
+    {
+    public:
+
+        fd_capture(int fd, std::streambuf& target);
+        ~fd_capture();
+
+        fd_capture(const fd_capture&) = delete;
+        fd_capture& operator=(const fd_capture&) = delete;
+
+        bool active() const;
+
+        // Forwards everything written to the file descriptor so far. The
+        // C stdio buffers must have been flushed beforehand.
+        void drain();
+
+    private:
+
+        void run();
+        std::size_t forward_available();
+
+        int m_fd;
+        int m_saved_fd;
+        int m_read_fd;
+        std::streambuf& m_target;
+        std::atomic<bool> m_stop;
+        std::mutex m_mutex;
+        std::thread m_reader;
+    };
+}
+
+#endif
@@ -0,0 +1,198 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "xeus/xinterpreter.hpp"
+
+#include "xeus-cling/xinterpreter.hpp"
+
+#include "xcpp/xdisplay.hpp"
+#include "xcpp/xthrottle.hpp"
+
+#include "xdisplay_throttler.hpp"
+
+namespace xcpp
+{
+    /***************************************
+     * Implementation of display_throttler *
+     ***************************************/
+
+    display_throttler::display_throttler(publisher_type publisher)
+        : m_publisher(std::move(publisher))
+        , m_owner(std::this_thread::get_id())
+        , m_slots()
+    {
+    }
+
+    void display_throttler::update(const std::string& display_id, factory_type factory, clock_type::duration interval)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot& s = m_slots[display_id];
+            s.pending = std::move(factory);
+            s.interval = interval;
+        }
+        poll();
+    }
+
+    void display_throttler::flush(const std::string& display_id, bool release)
+    {
+        std::vector<emission> emissions;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_slots.find(display_id);
+            if (it == m_slots.end())
+            {
+                return;
+            }
+            slot& s = it->second;
+            if (s.pending && !is_owner())
+            {
+                // Due at the next poll of the owner.
+                s.next = clock_type::time_point::min();
+                s.released = s.released || release;
+                return;
+            }
+            if (s.pending)
+            {
+                take(display_id, s, emissions);
+            }
+            if (release)
+            {
+                m_slots.erase(it);
+            }
+        }
+        emit(emissions);
+    }
+
+    void display_throttler::flush()
+    {
+        if (!is_owner())
+        {
+            return;
+        }
+        std::vector<emission> emissions;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            take_due(true, emissions);
+        }
+        emit(emissions);
+    }
+
+    void display_throttler::poll()
+    {
+        if (!is_owner())
+        {
+            return;
+        }
+        std::vector<emission> emissions;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            take_due(false, emissions);
+        }
+        emit(emissions);
+    }
+
+    bool display_throttler::is_owner() const
+    {
+        return std::this_thread::get_id() == m_owner;
+    }
+
+    void display_throttler::take_due(bool all, std::vector<emission>& emissions)
+    {
+        auto now = clock_type::now();
+        for (auto it = m_slots.begin(); it != m_slots.end();)
+        {
+            slot& s = it->second;
+            if (s.pending && (all || s.next <= now))
+            {
+                take(it->first, s, emissions);
+            }
+            if (s.released && !s.pending)
+            {
+                it = m_slots.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void display_throttler::take(const std::string& display_id, slot& s, std::vector<emission>& emissions)
+    {
+        emissions.push_back({display_id, std::move(s.pending), s.displayed});
+        s.pending = nullptr;
+        s.displayed = true;
+        s.next = clock_type::now() + s.interval;
+    }
+
+    void display_throttler::emit(std::vector<emission>& emissions)
+    {
+        for (auto& e : emissions)
+        {
+            nl::json bundle;
+            try
+            {
+                bundle = e.factory();
+            }
+            // The representation of the value failed. The values are also
+            // published at the end of the cell, where there is no one to
+            // report to.
+            catch (std::exception&)
+            {
+                continue;
+            }
+            catch (...)
+            {
+                continue;
+            }
+            m_publisher(std::move(bundle), e.display_id, e.update);
+        }
+    }
+
+    /*************************
+     * notebook-side helpers *
+     *************************/
+
+    static interpreter& get_cling_interpreter()
+    {
+        return dynamic_cast<interpreter&>(xeus::get_interpreter());
+    }
+
+    void publish_display_data(nl::json data, nl::json metadata, nl::json transient, bool update)
+    {
+        get_cling_interpreter().publish_display_data(std::move(data), std::move(metadata), std::move(transient), update);
+    }
+
+    namespace detail
+    {
+        void throttle_display(
+            const std::string& display_id,
+            std::function<nl::json()> factory,
+            std::chrono::steady_clock::duration interval
+        )
+        {
+            get_cling_interpreter().get_display_throttler().update(display_id, std::move(factory), interval);
+        }
+
+        void flush_display(const std::string& display_id, bool release)
+        {
+            get_cling_interpreter().get_display_throttler().flush(display_id, release);
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_DISPLAY_THROTTLER_HPP
+#define XCPP_DISPLAY_THROTTLER_HPP
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    /**
+     * Publishes the displays of the xcpp::throttled_display handles.
+     *
+     * Only the latest value of each display is kept, and it is computed and
+     * published at most once per interval of the display, by the thread
+     * which created the throttler: the interpreter thread, which sends the
+     * other messages of the kernel. A value is published when the display
+     * is updated or polled once its interval has elapsed, and when it is
+     * flushed. The values updated by other threads wait for the next of
+     * these calls on the owner thread. The first publication of a display
+     * is a display_data message, the following ones are update_display_data
+     * messages.
+     */
+    class display_throttler
+    {
+    public:
+
+        using factory_type = std::function<nl::json()>;
+        using publisher_type = std::function<void(nl::json, const std::string&, bool)>;
+        using clock_type = std::chrono::steady_clock;
+
+        explicit display_throttler(publisher_type publisher);
+
+        display_throttler(const display_throttler&) = delete;
+        display_throttler& operator=(const display_throttler&) = delete;
+
+        void update(const std::string& display_id, factory_type factory, clock_type::duration interval);
+
+        // Publishes the pending value of the display, if any. With release,
+        // the display is forgotten afterwards. On other threads than the
+        // owner, the value is published at the next poll.
+        void flush(const std::string& display_id, bool release = false);
+
+        // Publishes all the pending values, e.g. at the end of a cell.
+        void flush();
+
+        // Publishes the pending values whose interval has elapsed.
+        void poll();
+
+    private:
+
+        struct slot
+        {
+            factory_type pending;
+            clock_type::duration interval = clock_type::duration(0);
+            clock_type::time_point next;
+            bool displayed = false;
+            bool released = false;
+        };
+
+        struct emission
+        {
+            std::string display_id;
+            factory_type factory;
+            bool update;
+        };
+
+        bool is_owner() const;
+        void take_due(bool all, std::vector<emission>& emissions);
+        void take(const std::string& display_id, slot& s, std::vector<emission>& emissions);
+        void emit(std::vector<emission>& emissions);
+
+        publisher_type m_publisher;
+        std::thread::id m_owner;
+        std::map<std::string, slot> m_slots;
+        std::mutex m_mutex;
+    };
+}
+
+#endif
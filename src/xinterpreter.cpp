@@ -8,11 +8,14 @@
  ************************************************************************************/
 
 #include <algorithm>
+#include <chrono>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdio>
 #include <memory>
 #include <regex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <llvm/Support/DynamicLibrary.h>
@@ -24,19 +27,51 @@
 #include "xeus-cling/xinterpreter.hpp"
 #include "xeus-cling/xmagics.hpp"
 
+#include "xcapture.hpp"
+#include "xdisplay_throttler.hpp"
 #include "xinput.hpp"
 #include "xinspect.hpp"
+#include "xalloc_recorder.hpp"
+#include "xjitdump.hpp"
+#include "xmagics/allocprof.hpp"
+#include "xmagics/bench.hpp"
+#include "xmagics/benchenv.hpp"
+#include "xmagics/display.hpp"
 #include "xmagics/executable.hpp"
 #include "xmagics/execution.hpp"
+#include "xmagics/memory.hpp"
+#include "xmagics/optimize.hpp"
 #include "xmagics/os.hpp"
+#include "xmagics/perfstat.hpp"
+#include "xmagics/profile.hpp"
+#include "xmagics/timetrace.hpp"
+#include "xmagics/timing.hpp"
+#include "xmemory.hpp"
 #include "xmime_internal.hpp"
+#include "xoptimization.hpp"
 #include "xparser.hpp"
+#include "xphase_callbacks.hpp"
+#include "xphases.hpp"
+#include "xspill.hpp"
 #include "xsystem.hpp"
 
 using namespace std::placeholders;
 
 namespace xcpp
 {
+    // Stream output is published at most every 200 ms (as ipykernel does),
+    // or as soon as 1 MiB is pending. A cell may publish up to 8 MiB per
+    // stream, in at most 2000 messages, the rest is spilled to a file.
+    static xflush_policy output_flush_policy()
+    {
+        xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(200);
+        policy.max_bytes = std::size_t(1) << 20;
+        policy.cell_max_bytes = std::size_t(8) << 20;
+        policy.cell_max_messages = 2000;
+        return policy;
+    }
+
     void interpreter::configure_impl()
     {
         // Process #include "xeus/xinterpreter.hpp" in a separate block.
@@ -55,10 +90,31 @@ namespace xcpp
         xmagics()
         , p_cout_strbuf(nullptr)
         , p_cerr_strbuf(nullptr)
-        , m_cout_buffer(std::bind(&interpreter::publish_stdout, this, _1))
-        , m_cerr_buffer(std::bind(&interpreter::publish_stderr, this, _1))
+        , m_cout_buffer(std::bind(&interpreter::publish_stdout, this, _1), output_flush_policy())
+        , m_cerr_buffer(std::bind(&interpreter::publish_stderr, this, _1), output_flush_policy())
+        , m_interpreter_thread(std::this_thread::get_id())
+        , p_phase_timer(std::make_unique<phase_timer>())
+        , m_execution_counter(0)
+        , m_silent(false)
+        , m_cell_res()
+        , p_cell_optimization(std::make_unique<optimization_settings>())
+        , m_track_memory(false)
     {
+        p_display_throttler = std::make_unique<display_throttler>(
+            [this](nl::json data, const std::string& display_id, bool update)
+            {
+                nl::json transient;
+                transient["display_id"] = display_id;
+                send_display_data(std::move(data), nl::json::object(), std::move(transient), update);
+            }
+        );
         redirect_output();
+        // Before any code is compiled, so that the allocations of all the
+        // cells can be recorded by %%allocprof.
+        install_allocation_hooks();
+        install_allocation_callbacks(m_interpreter);
+        install_phase_callbacks(m_interpreter, *p_phase_timer);
+        install_mime_cache_callbacks(m_interpreter);
         init_extra_includes();
         init_libs();
         init_preamble();
@@ -67,7 +123,10 @@ namespace xcpp
 
     interpreter::~interpreter()
     {
+        p_display_throttler.reset();
+        flush_output();
         restore_output();
+        remove_session_directory();
     }
 
     nl::json interpreter::execute_request_impl(
@@ -81,17 +140,91 @@ namespace xcpp
     {
         nl::json kernel_res;
 
+        p_phase_timer->start(cell_phase::magics);
+        m_execution_counter = execution_counter;
+        m_silent = silent;
+        *p_cell_optimization = current_optimization(m_interpreter);
+        if (p_jitdump)
+        {
+            p_jitdump->begin_cell();
+        }
+        begin_cell_output(execution_counter);
+
+        // The tracking can be turned on by this cell.
+        std::unique_ptr<memory_tracker> memory;
+        if (m_track_memory)
+        {
+            memory = std::make_unique<memory_tracker>();
+            memory->start();
+        }
+
+        // Scope guard performing the temporary redirection of input requests.
+        auto input_guard = input_redirection(allow_stdin);
+
         // Check for magics
+        bool is_magic = false;
         for (auto& pre : preamble_manager.preamble)
         {
             if (pre.second.is_match(code))
             {
+                p_phase_timer->enter(cell_phase::execution);
+                // The magics do not publish their output for silent requests.
+                xnull null;
+                auto cout_strbuf = std::cout.rdbuf();
+                auto cerr_strbuf = std::cerr.rdbuf();
+                if (silent)
+                {
+                    std::cout.rdbuf(&null);
+                    std::cerr.rdbuf(&null);
+                }
                 pre.second.apply(code, kernel_res);
-                return kernel_res;
+                if (silent)
+                {
+                    std::cout.rdbuf(cout_strbuf);
+                    std::cerr.rdbuf(cerr_strbuf);
+                }
+                // The magics running the code of the cell reply with its
+                // status and its error.
+                if (!m_cell_res.is_null())
+                {
+                    kernel_res = std::move(m_cell_res);
+                    m_cell_res = nl::json();
+                }
+                is_magic = true;
+                break;
             }
         }
 
+        if (!is_magic)
+        {
+            kernel_res = execute_code(execution_counter, code, silent);
+        }
+
+        p_phase_timer->enter(cell_phase::publish);
+        end_cell_output();
+        if (p_jitdump)
+        {
+            p_jitdump->update();
+        }
+        p_phase_timer->stop();
+
+        // xeus sends the execute_reply with empty metadata, the timing, the
+        // optimization settings and the memory usage are added to its content.
+        kernel_res["timing"] = p_phase_timer->to_json();
+        kernel_res["optimization"] = p_cell_optimization->to_json();
+        if (memory)
+        {
+            kernel_res["memory"] = memory->stop().to_json();
+        }
+        return kernel_res;
+    }
+
+    nl::json interpreter::execute_code(int execution_counter, const std::string& code, bool silent)
+    {
+        nl::json kernel_res;
+
         // Split code from includes
+        p_phase_timer->enter(cell_phase::split);
         auto blocks = split_from_includes(code.c_str());
 
         auto errorlevel = 0;
@@ -114,11 +247,11 @@ namespace xcpp
             std::cerr.rdbuf(&null);
         }
 
-        // Scope guard performing the temporary redirection of input requests.
-        auto input_guard = input_redirection(allow_stdin);
-
         for (const auto& block : blocks)
         {
+            // The interpreter callbacks switch to the next phases.
+            p_phase_timer->enter(cell_phase::parse);
+
             // Attempt normal evaluation
             try
             {
@@ -160,9 +293,13 @@ namespace xcpp
             }
         }
 
-        // Flush streams
+        // Flush streams, the output of the cell is published before its
+        // result.
+        p_phase_timer->enter(cell_phase::publish);
         std::cout << std::flush;
         std::cerr << std::flush;
+        flush_displays();
+        flush_output();
 
         // Reset non-silent output buffers
         if (silent)
@@ -198,8 +335,13 @@ namespace xcpp
             // the semicolon was omitted.
             if (!silent && output.hasValue() && trim(blocks.back()).back() != ';')
             {
+                p_phase_timer->enter(cell_phase::display);
                 nl::json pub_data = mime_repr(output);
-                publish_execution_result(execution_counter, std::move(pub_data), nl::json::object());
+                p_phase_timer->enter(cell_phase::publish);
+                nl::json metadata;
+                metadata["timing"] = p_phase_timer->to_json();
+                metadata["optimization"] = current_optimization(m_interpreter).to_json();
+                publish_execution_result(execution_counter, std::move(pub_data), std::move(metadata));
             }
 
             // Compose execute_reply message.
@@ -327,30 +469,38 @@ namespace xcpp
 
     void interpreter::shutdown_request_impl()
     {
+        flush_output();
         restore_output();
     }
 
-    static std::string c_format(const char* format, std::va_list args)
+    // Formats into a stack buffer first, so that vsnprintf is called only
+    // once unless the output is larger than the buffer.
+    static int c_format(std::ostream& out, const char* format, std::va_list args)
     {
-        // Call vsnprintf once to determine the required buffer length. The
-        // return value is the number of characters _excluding_ the null byte.
-        std::va_list args_bufsz;
-        va_copy(args_bufsz, args);
-        std::size_t bufsz = vsnprintf(NULL, 0, format, args_bufsz);
-        va_end(args_bufsz);
+        char buf[512];
+        std::va_list args_format;
+        va_copy(args_format, args);
+        int size = vsnprintf(buf, sizeof(buf), format, args_format);
+        va_end(args_format);
 
-        // Create an empty string of that size.
-        std::string s(bufsz, 0);
+        if (size < 0)
+        {
+            return size;
+        }
+        if (static_cast<std::size_t>(size) < sizeof(buf))
+        {
+            out.write(buf, size);
+            return size;
+        }
 
-        // Now format the data into this string and return it.
-        std::va_list args_format;
+        // The return value is the number of characters _excluding_ the
+        // null byte, which vsnprintf needs room for.
+        std::string s(size, 0);
         va_copy(args_format, args);
-        // The second parameter is the maximum number of bytes that vsnprintf
-        // will write _including_ the  terminating null byte.
         vsnprintf(&s[0], s.size() + 1, format, args_format);
         va_end(args_format);
-
-        return s;
+        out.write(s.data(), size);
+        return size;
     }
 
     static int printf_jit(const char* format, ...)
@@ -358,12 +508,11 @@ namespace xcpp
         std::va_list args;
         va_start(args, format);
 
-        std::string buf = c_format(format, args);
-        std::cout << buf;
+        int ret = c_format(std::cout, format, args);
 
         va_end(args);
 
-        return buf.size();
+        return ret;
     }
 
     static int fprintf_jit(std::FILE* stream, const char* format, ...)
@@ -372,18 +521,13 @@ namespace xcpp
         va_start(args, format);
 
         int ret;
-        if (stream == stdout || stream == stderr)
+        if (stream == stdout)
         {
-            std::string buf = c_format(format, args);
-            if (stream == stdout)
-            {
-                std::cout << buf;
-            }
-            else if (stream == stderr)
-            {
-                std::cerr << buf;
-            }
-            ret = buf.size();
+            ret = c_format(std::cout, format, args);
+        }
+        else if (stream == stderr)
+        {
+            ret = c_format(std::cerr, format, args);
         }
         else
         {
@@ -412,6 +556,9 @@ namespace xcpp
 
     void interpreter::restore_output()
     {
+        p_stdout_capture.reset();
+        p_stderr_capture.reset();
+
         std::cout.rdbuf(p_cout_strbuf);
         std::cerr.rdbuf(p_cerr_strbuf);
 
@@ -419,6 +566,151 @@ namespace xcpp
         // to std::cout and std::cerr, these are handled implicitly.
     }
 
+    void interpreter::capture_fds()
+    {
+        if (p_stdout_capture)
+        {
+            return;
+        }
+        std::fflush(stdout);
+        std::fflush(stderr);
+        p_stdout_capture = std::make_unique<fd_capture>(1, m_cout_buffer);
+        p_stderr_capture = std::make_unique<fd_capture>(2, m_cerr_buffer);
+        // stdout is fully buffered when it is a pipe, line buffering keeps
+        // its output close to the one of std::cout.
+        std::setvbuf(stdout, nullptr, _IOLBF, BUFSIZ);
+    }
+
+    void interpreter::enable_jitdump()
+    {
+        if (p_jitdump)
+        {
+            return;
+        }
+        p_jitdump = std::make_unique<jitdump_writer>(m_interpreter);
+        if (!p_jitdump->open())
+        {
+            std::clog << "jitdump disabled: " << p_jitdump->message() << std::endl;
+            p_jitdump.reset();
+            return;
+        }
+        if (!p_jitdump->message().empty())
+        {
+            std::clog << "jitdump: " << p_jitdump->message() << std::endl;
+        }
+        std::clog << "Writing the jitdump to " << p_jitdump->path() << std::endl;
+    }
+
+    void interpreter::flush_output()
+    {
+        if (p_stdout_capture)
+        {
+            std::fflush(stdout);
+            std::fflush(stderr);
+            p_stdout_capture->drain();
+            p_stderr_capture->drain();
+        }
+        // Publish the output coalesced by the output buffers before the
+        // reply, so that it is attached to the current request.
+        m_cout_buffer.flush();
+        m_cerr_buffer.flush();
+    }
+
+    void interpreter::begin_cell_output(int execution_counter)
+    {
+        // The execution counter repeats for silent requests and for those
+        // which are not stored in the history, the sequence number does not.
+        static std::size_t sequence = 0;
+        std::string path = session_directory() + "/cell-" + std::to_string(execution_counter) + "-"
+                           + std::to_string(++sequence) + ".log";
+        p_spill = std::make_unique<spill_file>(std::move(path));
+        auto spill = [this](const char* s, std::size_t count)
+        {
+            p_spill->write(s, count);
+        };
+        m_cout_buffer.begin_cell(spill);
+        m_cerr_buffer.begin_cell(spill);
+    }
+
+    void interpreter::end_cell_output()
+    {
+        flush_displays();
+        flush_output();
+        xcell_output out = m_cout_buffer.end_cell();
+        xcell_output err = m_cerr_buffer.end_cell();
+        std::size_t spilled = out.spilled_bytes + err.spilled_bytes;
+        if (spilled != 0)
+        {
+            std::string message = "\n[Output truncated: " + std::to_string(spilled) + " bytes not shown";
+            if (p_spill->size() != 0)
+            {
+                message += ", the rest of the output is in " + p_spill->path();
+            }
+            message += "]\n";
+            publish_stderr(message);
+        }
+        p_spill.reset();
+    }
+
+    void interpreter::publish_display_data(nl::json data, nl::json metadata, nl::json transient, bool update)
+    {
+        if (std::this_thread::get_id() != m_interpreter_thread)
+        {
+            std::lock_guard<std::mutex> lock(m_display_mutex);
+            m_deferred_displays.push_back({std::move(data), std::move(metadata), std::move(transient), update});
+            return;
+        }
+        send_display_data(std::move(data), std::move(metadata), std::move(transient), update);
+    }
+
+    void interpreter::flush_displays()
+    {
+        publish_pending_output();
+        p_display_throttler->flush();
+    }
+
+    void interpreter::send_display_data(nl::json data, nl::json metadata, nl::json transient, bool update)
+    {
+        publish_pending_output();
+        if (update)
+        {
+            update_display_data(std::move(data), std::move(metadata), std::move(transient));
+        }
+        else
+        {
+            display_data(std::move(data), std::move(metadata), std::move(transient));
+        }
+    }
+
+    void interpreter::publish_pending_output()
+    {
+        // The stream output collected so far is published first, then the
+        // displays of the other threads.
+        m_cout_buffer.poll();
+        m_cerr_buffer.poll();
+        std::vector<deferred_display> deferred;
+        {
+            std::lock_guard<std::mutex> lock(m_display_mutex);
+            deferred.swap(m_deferred_displays);
+        }
+        for (auto& d : deferred)
+        {
+            if (d.update)
+            {
+                update_display_data(std::move(d.data), std::move(d.metadata), std::move(d.transient));
+            }
+            else
+            {
+                display_data(std::move(d.data), std::move(d.metadata), std::move(d.transient));
+            }
+        }
+    }
+
+    display_throttler& interpreter::get_display_throttler()
+    {
+        return *p_display_throttler;
+    }
+
     void interpreter::publish_stdout(const std::string& s)
     {
         publish_stream("stdout", s);
@@ -457,8 +749,56 @@ namespace xcpp
             "executable",
             executable(m_interpreter)
         );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "display_budget",
+            display_budget_magic()
+        );
         preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("file", writefile());
         preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("timeit", timeit(&m_interpreter));
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("bench", bench(&m_interpreter));
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("benchenv", benchenv());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "autotune",
+            autotune(&m_interpreter)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "perfstat",
+            perfstat(&m_interpreter)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("prun", prun(&m_interpreter));
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "memit",
+            memit(&m_interpreter, &m_track_memory)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "optimize",
+            optimize(
+                &m_interpreter,
+                [this](const std::string& code)
+                {
+                    m_cell_res = execute_code(m_execution_counter, code, m_silent);
+                },
+                p_cell_optimization.get()
+            )
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "allocprof",
+            allocprof(&m_interpreter)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "timetrace",
+            timetrace(&m_interpreter)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "timing",
+            timing(
+                [this](const std::string& code)
+                {
+                    m_cell_res = execute_code(m_execution_counter, code, m_silent);
+                },
+                *p_phase_timer
+            )
+        );
     }
 
     std::string interpreter::get_stdopt(int argc, const char* const* argv)
@@ -0,0 +1,210 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+#include "cling/Interpreter/Transaction.h"
+
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/Decl.h"
+#include "clang/AST/DeclCXX.h"
+#include "clang/AST/GlobalDecl.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Frontend/CompilerInstance.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "xjit_symbols.hpp"
+
+namespace xcpp
+{
+    jit_symbols::jit_symbols(cling::Interpreter& interpreter)
+        : m_interpreter(interpreter)
+    {
+    }
+
+    void jit_symbols::update()
+    {
+        const cling::Transaction* transaction = m_interpreter.getFirstTransaction();
+        for (; transaction != nullptr; transaction = transaction->getNext())
+        {
+            add_transaction(*transaction);
+        }
+    }
+
+    const std::string* jit_symbols::at(const void* start) const
+    {
+        auto it = m_symbols.find(reinterpret_cast<std::uintptr_t>(start));
+        return it != m_symbols.end() ? &it->second : nullptr;
+    }
+
+    const std::string* jit_symbols::find(const void* address, const void** start) const
+    {
+        auto it = m_symbols.upper_bound(reinterpret_cast<std::uintptr_t>(address));
+        if (it == m_symbols.begin())
+        {
+            return nullptr;
+        }
+        --it;
+        *start = reinterpret_cast<const void*>(it->first);
+        return &it->second;
+    }
+
+    const source_location* jit_symbols::location(const void* start) const
+    {
+        auto it = m_locations.find(reinterpret_cast<std::uintptr_t>(start));
+        return it != m_locations.end() ? &it->second : nullptr;
+    }
+
+    const std::string* jit_symbols::source(const std::string& file) const
+    {
+        auto it = m_sources.find(file);
+        return it != m_sources.end() ? &it->second : nullptr;
+    }
+
+    void jit_symbols::add_transaction(const cling::Transaction& transaction)
+    {
+        for (auto it = transaction.decls_begin(); it != transaction.decls_end(); ++it)
+        {
+            bool instantiation = it->m_Call == cling::Transaction::kCCIHandleCXXImplicitFunctionInstantiation;
+            for (const clang::Decl* decl : it->m_DGR)
+            {
+                add_decl(decl, instantiation);
+            }
+        }
+        if (transaction.hasNestedTransactions())
+        {
+            for (auto it = transaction.nested_begin(); it != transaction.nested_end(); ++it)
+            {
+                add_transaction(**it);
+            }
+        }
+    }
+
+    void jit_symbols::add_decl(const clang::Decl* decl, bool instantiation)
+    {
+        if (decl == nullptr || !m_seen.insert(decl).second)
+        {
+            return;
+        }
+        // Instantiations are added wherever their template comes from, since
+        // they are only emitted for the code that uses them.
+        if (!instantiation && !is_from_input(decl))
+        {
+            return;
+        }
+
+        if (llvm::isa<clang::NamespaceDecl>(decl) || llvm::isa<clang::LinkageSpecDecl>(decl))
+        {
+            for (const clang::Decl* child : llvm::cast<clang::DeclContext>(decl)->decls())
+            {
+                add_decl(child, false);
+            }
+        }
+        else if (auto record = llvm::dyn_cast<clang::CXXRecordDecl>(decl))
+        {
+            if (record->hasDefinition() && !record->isDependentContext())
+            {
+                for (const clang::CXXMethodDecl* method : record->methods())
+                {
+                    add_function(method);
+                }
+            }
+        }
+        else if (auto function = llvm::dyn_cast<clang::FunctionDecl>(decl))
+        {
+            add_function(function);
+        }
+    }
+
+    void jit_symbols::add_function(const clang::FunctionDecl* function)
+    {
+        if (!function->isThisDeclarationADefinition() || function->isDependentContext()
+            || function->getDescribedFunctionTemplate() != nullptr)
+        {
+            return;
+        }
+
+        clang::GlobalDecl global;
+        if (auto ctor = llvm::dyn_cast<clang::CXXConstructorDecl>(function))
+        {
+            global = clang::GlobalDecl(ctor, clang::Ctor_Complete);
+        }
+        else if (auto dtor = llvm::dyn_cast<clang::CXXDestructorDecl>(function))
+        {
+            global = clang::GlobalDecl(dtor, clang::Dtor_Complete);
+        }
+        else
+        {
+            global = clang::GlobalDecl(function);
+        }
+
+        // Functions which were not emitted, such as unused inline ones, have
+        // no address.
+        bool from_jit = false;
+        void* address = m_interpreter.getAddressOfGlobal(global, &from_jit);
+        if (address == nullptr || !from_jit)
+        {
+            return;
+        }
+
+        std::string name;
+        llvm::raw_string_ostream os(name);
+        clang::PrintingPolicy policy = function->getASTContext().getPrintingPolicy();
+        function->getNameForDiagnostic(os, policy, /*Qualified=*/true);
+        os.flush();
+        // The statements of a cell are wrapped in such a function.
+        if (name.compare(0, 14, "__cling_Un1Qu3") == 0)
+        {
+            name = "<cell>";
+        }
+        m_symbols[reinterpret_cast<std::uintptr_t>(address)] = name;
+        add_location(function, reinterpret_cast<std::uintptr_t>(address));
+    }
+
+    void jit_symbols::add_location(const clang::FunctionDecl* function, std::uintptr_t address)
+    {
+        const clang::SourceManager& sm = m_interpreter.getCI()->getSourceManager();
+        clang::SourceLocation loc = sm.getExpansionLoc(function->getLocation());
+        clang::PresumedLoc presumed = sm.getPresumedLoc(loc);
+        if (presumed.isInvalid())
+        {
+            return;
+        }
+        std::string file = presumed.getFilename();
+        m_locations[address] = source_location{file, presumed.getLine()};
+
+        // The buffers of the interpreter only exist in memory, their text is
+        // kept for the tools which show the source of the functions.
+        if (file.compare(0, 11, "input_line_") == 0 && m_sources.find(file) == m_sources.end())
+        {
+            bool invalid = false;
+            llvm::StringRef text = sm.getBufferData(sm.getFileID(loc), &invalid);
+            if (!invalid)
+            {
+                m_sources[file] = text.str();
+            }
+        }
+    }
+
+    bool jit_symbols::is_from_input(const clang::Decl* decl) const
+    {
+        // The code given to the interpreter is parsed from memory buffers
+        // named input_line_N.
+        const clang::SourceManager& sm = m_interpreter.getCI()->getSourceManager();
+        clang::SourceLocation loc = sm.getExpansionLoc(decl->getLocation());
+        if (loc.isInvalid())
+        {
+            return false;
+        }
+        return sm.getFilename(loc).startswith("input_line_");
+    }
+}
@@ -0,0 +1,84 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_JIT_SYMBOLS_HPP
+#define XCPP_JIT_SYMBOLS_HPP
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+namespace clang
+{
+    class Decl;
+    class FunctionDecl;
+}
+
+namespace cling
+{
+    class Interpreter;
+    class Transaction;
+}
+
+namespace xcpp
+{
+    struct source_location
+    {
+        std::string file;
+        unsigned line;
+    };
+
+    /**
+     * Start addresses and names of the functions compiled by the JIT for
+     * the code of the notebook: functions and methods defined in cells,
+     * the wrappers of the cells, and the template instantiations they
+     * required. Code coming from headers is not included.
+     */
+    class jit_symbols
+    {
+    public:
+
+        explicit jit_symbols(cling::Interpreter& interpreter);
+
+        // Adds the functions of the transactions processed since the last
+        // call.
+        void update();
+
+        // Name of the function starting at the given address, or nullptr.
+        const std::string* at(const void* start) const;
+
+        // Name and start of the closest function starting at or before the
+        // given address, or nullptr.
+        const std::string* find(const void* address, const void** start) const;
+
+        // File and line of the definition of the function starting at the
+        // given address, or nullptr.
+        const source_location* location(const void* start) const;
+
+        // Text of a buffer of the interpreter named input_line_N, or nullptr.
+        const std::string* source(const std::string& file) const;
+
+    private:
+
+        void add_transaction(const cling::Transaction& transaction);
+        void add_decl(const clang::Decl* decl, bool instantiation);
+        void add_function(const clang::FunctionDecl* function);
+        void add_location(const clang::FunctionDecl* function, std::uintptr_t address);
+        bool is_from_input(const clang::Decl* decl) const;
+
+        cling::Interpreter& m_interpreter;
+        std::set<const clang::Decl*> m_seen;
+        std::map<std::uintptr_t, std::string> m_symbols;
+        std::map<std::uintptr_t, source_location> m_locations;
+        std::map<std::string, std::string> m_sources;
+    };
+}
+
+#endif
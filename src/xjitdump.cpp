@@ -0,0 +1,318 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#ifdef __linux__
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "xjitdump.hpp"
+
+namespace fs = std::filesystem;
+
+namespace xcpp
+{
+    std::string perf_map_path()
+    {
+#ifdef _WIN32
+        int pid = _getpid();
+#else
+        int pid = ::getpid();
+#endif
+        return "/tmp/perf-" + std::to_string(pid) + ".map";
+    }
+
+#ifdef __linux__
+    // Layout of the file, described in
+    // tools/perf/Documentation/jitdump-specification.txt in the Linux sources.
+    constexpr std::uint32_t jitdump_magic = 0x4A695444;
+    constexpr std::uint32_t jitdump_version = 1;
+    constexpr std::uint32_t jit_code_load = 0;
+    constexpr std::uint32_t jit_code_debug_info = 2;
+
+    static std::uint32_t elf_machine()
+    {
+#if defined(__x86_64__)
+        return EM_X86_64;
+#elif defined(__i386__)
+        return EM_386;
+#elif defined(__aarch64__)
+        return EM_AARCH64;
+#elif defined(__arm__)
+        return EM_ARM;
+#elif defined(__powerpc64__)
+        return EM_PPC64;
+#else
+        return EM_NONE;
+#endif
+    }
+
+    // perf must be run with -k mono to use the same clock.
+    static std::uint64_t monotonic_ns()
+    {
+        timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+    }
+
+    template <class T>
+    static void write_value(std::FILE* file, T value)
+    {
+        std::fwrite(&value, sizeof(T), 1, file);
+    }
+
+    static void write_string(std::FILE* file, const std::string& s)
+    {
+        std::fwrite(s.c_str(), 1, s.size() + 1, file);
+    }
+
+    static void
+    write_record_header(std::FILE* file, std::uint32_t id, std::size_t size, std::uint64_t timestamp)
+    {
+        write_value(file, id);
+        write_value(file, static_cast<std::uint32_t>(size));
+        write_value(file, timestamp);
+    }
+#endif
+
+    jitdump_writer::jitdump_writer(cling::Interpreter& interpreter)
+        : m_symbols(interpreter)
+        , m_directory()
+        , m_path()
+        , m_message()
+        , p_file(nullptr)
+        , p_marker(nullptr)
+        , m_marker_size(0)
+        , m_map_offset(0)
+        , m_code_index(0)
+        , m_timestamp(0)
+        , m_written_sources()
+    {
+    }
+
+    jitdump_writer::~jitdump_writer()
+    {
+#ifdef __linux__
+        if (p_marker != nullptr)
+        {
+            ::munmap(p_marker, m_marker_size);
+        }
+        if (p_file != nullptr)
+        {
+            std::fclose(p_file);
+        }
+#endif
+    }
+
+    bool jitdump_writer::open()
+    {
+#ifdef __linux__
+        const char* root = std::getenv("JITDUMPDIR");
+        if (root == nullptr)
+        {
+            root = std::getenv("HOME");
+        }
+        if (root == nullptr)
+        {
+            root = ".";
+        }
+        std::string pid = std::to_string(::getpid());
+        m_directory = (fs::path(root) / ".debug" / "jit" / ("xcpp-" + pid)).string();
+        std::error_code ec;
+        fs::create_directories(m_directory, ec);
+        if (ec)
+        {
+            m_message = "cannot create " + m_directory + ": " + ec.message();
+            return false;
+        }
+
+        // perf finds the dump through its name and through a mapping of
+        // the file with execute permission.
+        m_path = m_directory + "/jit-" + pid + ".dump";
+        p_file = std::fopen(m_path.c_str(), "w+");
+        if (p_file == nullptr)
+        {
+            m_message = "cannot open " + m_path + ": " + std::strerror(errno);
+            return false;
+        }
+        m_marker_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        p_marker = ::mmap(nullptr, m_marker_size, PROT_READ | PROT_EXEC, MAP_PRIVATE, ::fileno(p_file), 0);
+        if (p_marker == MAP_FAILED)
+        {
+            p_marker = nullptr;
+            m_message = std::string("cannot map ") + m_path + ": " + std::strerror(errno);
+            return false;
+        }
+
+        write_value(p_file, jitdump_magic);
+        write_value(p_file, jitdump_version);
+        write_value(p_file, std::uint32_t(40));
+        write_value(p_file, elf_machine());
+        write_value(p_file, std::uint32_t(0));
+        write_value(p_file, static_cast<std::uint32_t>(::getpid()));
+        write_value(p_file, monotonic_ns());
+        write_value(p_file, std::uint64_t(0));
+        std::fflush(p_file);
+
+        std::ifstream map(perf_map_path());
+        if (!map)
+        {
+            m_message = perf_map_path() + " is not written, cling may have been built without perf support";
+        }
+        update();
+        return true;
+#else
+        m_message = "jitdump is only supported on Linux";
+        return false;
+#endif
+    }
+
+    void jitdump_writer::begin_cell()
+    {
+#ifdef __linux__
+        m_timestamp = monotonic_ns();
+#endif
+    }
+
+    void jitdump_writer::update()
+    {
+#ifdef __linux__
+        if (p_file == nullptr)
+        {
+            return;
+        }
+        std::uint64_t timestamp = m_timestamp != 0 ? m_timestamp : monotonic_ns();
+        m_timestamp = 0;
+
+        std::ifstream map(perf_map_path());
+        if (!map || !map.seekg(m_map_offset))
+        {
+            return;
+        }
+        m_symbols.update();
+
+        // Each line is "<start> <size> <name>", in hexadecimal. A line
+        // which is not terminated is read at the next update.
+        std::string line;
+        while (std::getline(map, line) && !map.eof())
+        {
+            m_map_offset = static_cast<long long>(map.tellg());
+            std::istringstream is(line);
+            std::uint64_t address = 0;
+            std::uint64_t size = 0;
+            std::string name;
+            if (!(is >> std::hex >> address >> size) || !std::getline(is >> std::ws, name) || size == 0)
+            {
+                continue;
+            }
+            if (const source_location* location = m_symbols.location(reinterpret_cast<const void*>(address)))
+            {
+                write_debug_info(timestamp, address, *location);
+            }
+            write_function(timestamp, address, size, name);
+        }
+        std::fflush(p_file);
+#endif
+    }
+
+    const std::string& jitdump_writer::path() const
+    {
+        return m_path;
+    }
+
+    const std::string& jitdump_writer::message() const
+    {
+        return m_message;
+    }
+
+    void jitdump_writer::write_function(
+        std::uint64_t timestamp,
+        std::uint64_t address,
+        std::uint64_t size,
+        const std::string& name
+    )
+    {
+#ifdef __linux__
+        std::size_t record_size = 16 + 4 + 4 + 8 + 8 + 8 + 8 + name.size() + 1 + size;
+        write_record_header(p_file, jit_code_load, record_size, timestamp);
+        write_value(p_file, static_cast<std::uint32_t>(::getpid()));
+        write_value(p_file, static_cast<std::uint32_t>(::syscall(SYS_gettid)));
+        write_value(p_file, address);
+        write_value(p_file, address);
+        write_value(p_file, size);
+        write_value(p_file, m_code_index++);
+        write_string(p_file, name);
+        std::fwrite(reinterpret_cast<const void*>(address), 1, size, p_file);
+#else
+        (void)timestamp;
+        (void)address;
+        (void)size;
+        (void)name;
+#endif
+    }
+
+    void jitdump_writer::write_debug_info(
+        std::uint64_t timestamp,
+        std::uint64_t address,
+        const source_location& location
+    )
+    {
+#ifdef __linux__
+        // A single entry: the whole function is attributed to the line of
+        // its definition.
+        std::string file = source_path(location.file);
+        std::size_t record_size = 16 + 8 + 8 + 8 + 4 + 4 + file.size() + 1;
+        write_record_header(p_file, jit_code_debug_info, record_size, timestamp);
+        write_value(p_file, address);
+        write_value(p_file, std::uint64_t(1));
+        write_value(p_file, address);
+        write_value(p_file, static_cast<std::uint32_t>(location.line));
+        write_value(p_file, std::uint32_t(0));
+        write_string(p_file, file);
+#else
+        (void)timestamp;
+        (void)address;
+        (void)location;
+#endif
+    }
+
+    std::string jitdump_writer::source_path(const std::string& file)
+    {
+        const std::string* text = m_symbols.source(file);
+        if (text == nullptr)
+        {
+            return file;
+        }
+        // The cells are written next to the dump, where perf reads them.
+        std::string path = m_directory + "/" + file + ".cpp";
+        if (m_written_sources.insert(file).second)
+        {
+            std::ofstream out(path);
+            out << *text;
+        }
+        return path;
+    }
+}
@@ -0,0 +1,92 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_JITDUMP_HPP
+#define XCPP_JITDUMP_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <string>
+
+#include "xjit_symbols.hpp"
+
+namespace cling
+{
+    class Interpreter;
+}
+
+namespace xcpp
+{
+    // Path of the map of the JIT-compiled functions read by perf.
+    std::string perf_map_path();
+
+    /**
+     * Writes the functions compiled by the JIT in the jitdump format of
+     * perf, which `perf inject --jit` turns into ELF files so that `perf
+     * report` and `perf annotate` can show their code and their source.
+     *
+     * The functions and their sizes are read from the perf map written by
+     * the JIT, the source of the functions defined in the notebook is the
+     * line of their definition. The dump is written to
+     * $JITDUMPDIR/.debug/jit/xcpp-<pid>/jit-<pid>.dump ($HOME if JITDUMPDIR
+     * is not set), along with the text of the cells. Only supported on Linux.
+     */
+    class jitdump_writer
+    {
+    public:
+
+        explicit jitdump_writer(cling::Interpreter& interpreter);
+        ~jitdump_writer();
+
+        jitdump_writer(const jitdump_writer&) = delete;
+        jitdump_writer& operator=(const jitdump_writer&) = delete;
+
+        // Returns false, with the reason in message(), if the dump cannot be
+        // written.
+        bool open();
+
+        // Marks the start of the execution of a cell: the functions it
+        // compiles are dated from then, so that perf attributes the samples
+        // of their first run.
+        void begin_cell();
+
+        // Writes the functions added to the perf map since the last call.
+        void update();
+
+        const std::string& path() const;
+        const std::string& message() const;
+
+    private:
+
+        void write_function(
+            std::uint64_t timestamp,
+            std::uint64_t address,
+            std::uint64_t size,
+            const std::string& name
+        );
+        void
+        write_debug_info(std::uint64_t timestamp, std::uint64_t address, const source_location& location);
+        std::string source_path(const std::string& file);
+
+        jit_symbols m_symbols;
+        std::string m_directory;
+        std::string m_path;
+        std::string m_message;
+        std::FILE* p_file;
+        void* p_marker;
+        std::size_t m_marker_size;
+        long long m_map_offset;
+        std::uint64_t m_code_index;
+        std::uint64_t m_timestamp;
+        std::set<std::string> m_written_sources;
+    };
+}
+
+#endif
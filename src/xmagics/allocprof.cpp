@@ -0,0 +1,222 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "allocprof.hpp"
+#include "../xalloc_recorder.hpp"
+#include "../xparser.hpp"
+#include "../xsymbolizer.hpp"
+
+namespace xcpp
+{
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Profile the heap allocations made by the execution of C++ statements");
+        argpars.add_argument("-l", "--limit")
+            .help("number of allocation sites displayed")
+            .default_value(15)
+            .scan<'i', int>();
+        argpars.add_argument("-d", "--depth")
+            .help("maximum number of frames recorded per allocation")
+            .default_value(16)
+            .scan<'i', int>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    /********************
+     * Allocation sites *
+     ********************/
+
+    static std::string format_bytes(std::size_t bytes)
+    {
+        char buf[32];
+        if (bytes < 1024)
+        {
+            std::snprintf(buf, sizeof(buf), "%zu B", bytes);
+        }
+        else if (bytes < 1024 * 1024)
+        {
+            std::snprintf(buf, sizeof(buf), "%.1f KiB", bytes / 1024.);
+        }
+        else if (bytes < 1024 * 1024 * 1024)
+        {
+            std::snprintf(buf, sizeof(buf), "%.1f MiB", bytes / 1048576.);
+        }
+        else
+        {
+            std::snprintf(buf, sizeof(buf), "%.2f GiB", bytes / 1073741824.);
+        }
+        return buf;
+    }
+
+    // The site of an allocation is the innermost function defined in a
+    // cell, with the line of its definition, and the innermost function
+    // compiled by the JIT when it is another one, such as the allocator of
+    // a container.
+    static std::string allocation_site(
+        const std::vector<void*>& stack,
+        symbolizer& symbolize,
+        const jit_symbols& symbols
+    )
+    {
+        const frame_symbol* innermost = nullptr;
+        for (void* address : stack)
+        {
+            const frame_symbol& frame = symbolize(address, false);
+            if (!frame.jit)
+            {
+                continue;
+            }
+            if (innermost == nullptr)
+            {
+                innermost = &frame;
+            }
+            const source_location* location = nullptr;
+            if (frame.start != nullptr)
+            {
+                location = symbols.location(frame.start);
+            }
+            if (location != nullptr && location->file.compare(0, 11, "input_line_") == 0)
+            {
+                std::string res = frame.name + " (" + location->file + ":" + std::to_string(location->line)
+                                  + ")";
+                if (innermost != &frame)
+                {
+                    res += " via " + innermost->name;
+                }
+                return res;
+            }
+        }
+        return innermost != nullptr ? innermost->name : "[unknown]";
+    }
+
+    static std::vector<std::pair<std::string, allocation_stats>>
+    allocation_sites(const allocation_recorder& recorder, symbolizer& symbolize, const jit_symbols& symbols)
+    {
+        std::map<std::string, allocation_stats> sites;
+        for (const auto& entry : recorder.stacks())
+        {
+            allocation_stats& stats = sites[allocation_site(entry.first, symbolize, symbols)];
+            stats.count += entry.second.count;
+            stats.bytes += entry.second.bytes;
+        }
+        std::vector<std::pair<std::string, allocation_stats>> res(sites.begin(), sites.end());
+        std::sort(
+            res.begin(),
+            res.end(),
+            [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.second.bytes > rhs.second.bytes
+                       || (lhs.second.bytes == rhs.second.bytes && lhs.second.count > rhs.second.count);
+            }
+        );
+        return res;
+    }
+
+    /*******************************
+     * Implementation of allocprof *
+     *******************************/
+
+    allocprof::allocprof(cling::Interpreter* p)
+        : m_interpreter(p)
+        , p_symbols(std::make_shared<jit_symbols>(*p))
+    {
+    }
+
+    void allocprof::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("allocprof", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true || trim(cell).empty())
+        {
+            return;
+        }
+        std::size_t limit = static_cast<std::size_t>(std::max(argpars.get<int>("-l"), 1));
+        std::size_t depth = static_cast<std::size_t>(std::max(argpars.get<int>("-d"), 1));
+
+        allocation_recorder recorder(depth);
+        if (!recorder.start())
+        {
+            std::cerr << "Cannot profile the allocations of the cell: " << recorder.message() << std::endl;
+            return;
+        }
+        try
+        {
+            m_interpreter->process(cell);
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        recorder.stop();
+
+        const allocation_stats& total = recorder.total();
+        std::cout << total.count << " allocations, " << format_bytes(total.bytes) << "\n";
+        if (total.count == 0)
+        {
+            std::cout << std::flush;
+            return;
+        }
+
+        std::ostringstream os;
+        os << "\n" << std::setw(10) << "size" << std::setw(12) << "count" << std::setw(12) << "bytes" << "\n";
+        for (std::size_t i = 0; i < allocation_size_classes; ++i)
+        {
+            const allocation_stats& stats = recorder.size_classes()[i];
+            if (stats.count != 0)
+            {
+                os << std::setw(10) << size_class_name(i) << std::setw(12) << stats.count << std::setw(12)
+                   << format_bytes(stats.bytes) << "\n";
+            }
+        }
+
+        p_symbols->update();
+        symbolizer symbolize(*p_symbols);
+        auto sites = allocation_sites(recorder, symbolize, *p_symbols);
+        os << "\n" << std::setw(10) << "count" << std::setw(12) << "bytes" << "  site\n";
+        std::size_t count = std::min(limit, sites.size());
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const allocation_stats& stats = sites[i].second;
+            os << std::setw(10) << stats.count << std::setw(12) << format_bytes(stats.bytes) << "  "
+               << sites[i].first << "\n";
+        }
+        std::cout << os.str() << std::flush;
+    }
+}
@@ -0,0 +1,46 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_ALLOCPROF_HPP
+#define XMAGICS_ALLOCPROF_HPP
+
+#include <memory>
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+#include "../xjit_symbols.hpp"
+
+namespace xcpp
+{
+    /**
+     * Runs the cell while recording the heap allocations made by the code
+     * of the notebook, and displays their number and size by size class
+     * and by allocation site.
+     */
+    class allocprof : public xmagic_cell
+    {
+    public:
+
+        allocprof(cling::Interpreter* p);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+        // Shared by the copies of the magic, and kept between runs so that
+        // the declarations are only scanned once.
+        std::shared_ptr<jit_symbols> p_symbols;
+    };
+}
+#endif
@@ -0,0 +1,809 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xcpp/xtimeit.hpp"
+
+#include "bench.hpp"
+#include "execution.hpp"
+#include "../xbench_internal.hpp"
+#include "../xbenchenv.hpp"
+#include "../xparser.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    struct bench_variant
+    {
+        std::string name;
+        std::string code;
+    };
+
+    struct bench_result
+    {
+        std::string variant;
+        std::size_t parameter;
+        timeit_result timing;
+        double items;
+        double bytes;
+    };
+
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Compare the execution time of several variants of C++ statements");
+        argpars.add_argument("-p", "--param")
+            .help("parameter of the variants, as NAME=1K..1M[:FACTOR] or NAME=V1,V2,...")
+            .default_value(std::string(""));
+        argpars.add_argument("-r", "--repeat")
+            .help("number of timed runs of each variant, interleaved with the runs of the other variants")
+            .default_value(7)
+            .scan<'i', int>();
+        argpars.add_argument("-t", "--min-time")
+            .help("minimum duration of a run in seconds, from which the number of loops is chosen")
+            .default_value(0.05)
+            .scan<'g', double>();
+        argpars.add_argument("--items")
+            .help("number of items processed by one loop, as an expression of the parameter")
+            .default_value(std::string(""));
+        argpars.add_argument("--bytes")
+            .help("number of bytes processed by one loop, as an expression of the parameter")
+            .default_value(std::string(""));
+        argpars.add_argument("--save")
+            .help("save the results to the given JSON file")
+            .default_value(std::string(""));
+        argpars.add_argument("--baseline")
+            .help("compare the results to those saved in the given JSON file")
+            .default_value(std::string(""));
+        argpars.add_argument("--threshold")
+            .help("relative slowdown against the baseline reported as a regression")
+            .default_value(0.05)
+            .scan<'g', double>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    /********************
+     * Variants parsing *
+     ********************/
+
+    // The statements before the first "--- name" line are the setup.
+    static std::vector<bench_variant> parse_variants(const std::string& cell, std::string& setup)
+    {
+        std::vector<bench_variant> res;
+        std::istringstream iss(cell);
+        std::string line;
+        while (std::getline(iss, line))
+        {
+            std::string tline = trim(line);
+            if (tline.compare(0, 3, "---") == 0)
+            {
+                std::string name = trim(tline.substr(3));
+                res.push_back({name.empty() ? "variant " + std::to_string(res.size() + 1) : name, ""});
+            }
+            else if (res.empty())
+            {
+                setup += line + "\n";
+            }
+            else
+            {
+                res.back().code += line + "\n";
+            }
+        }
+        return res;
+    }
+
+    /**************
+     * Formatting *
+     **************/
+
+    static std::string format_rate(double rate, bool binary)
+    {
+        static const char* decimal_units[] = {"", "k", "M", "G", "T"};
+        static const char* binary_units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+        double base = binary ? 1024. : 1000.;
+        std::size_t order = 0;
+        while (rate >= base && order < 4)
+        {
+            rate /= base;
+            ++order;
+        }
+        char buf[32];
+        const char* unit = binary ? binary_units[order] : decimal_units[order];
+        std::snprintf(buf, sizeof(buf), "%.3g %s/s", rate, unit);
+        return buf;
+    }
+
+    static std::string format_double(const char* format, double value)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), format, value);
+        return buf;
+    }
+
+    static void print_table(const std::vector<std::vector<std::string>>& rows)
+    {
+        std::vector<std::size_t> widths;
+        for (const auto& row : rows)
+        {
+            widths.resize(std::max(widths.size(), row.size()), 0);
+            for (std::size_t i = 0; i < row.size(); ++i)
+            {
+                widths[i] = std::max(widths[i], row[i].size());
+            }
+        }
+        for (std::size_t r = 0; r < rows.size(); ++r)
+        {
+            std::string line;
+            for (std::size_t i = 0; i < rows[r].size(); ++i)
+            {
+                line += rows[r][i] + std::string(widths[i] - rows[r][i].size() + 2, ' ');
+            }
+            std::cout << trim(line) << "\n";
+            if (r == 0)
+            {
+                std::size_t total = 0;
+                for (std::size_t w : widths)
+                {
+                    total += w + 2;
+                }
+                std::cout << std::string(total - 2, '-') << "\n";
+            }
+        }
+        std::cout << std::flush;
+    }
+
+    /***************
+     * Persistence *
+     ***************/
+
+    static nl::json to_json(const std::string& parameter, const std::vector<bench_result>& results)
+    {
+        nl::json res;
+        res["parameter"] = parameter;
+        res["environment"] = get_bench_environment().describe();
+        res["results"] = nl::json::array();
+        for (const auto& r : results)
+        {
+            res["results"].push_back({
+                {"variant", r.variant},
+                {"parameter", r.parameter},
+                {"loops", r.timing.loops},
+                {"median", r.timing.median},
+                {"mean", r.timing.mean},
+                {"stdev", r.timing.stdev},
+                {"runs", r.timing.all_runs}
+            });
+        }
+        return res;
+    }
+
+    using baseline_type = std::map<std::pair<std::string, std::size_t>, std::vector<double>>;
+
+    static baseline_type load_baseline(const std::string& filename)
+    {
+        std::ifstream in(filename);
+        if (!in)
+        {
+            throw std::runtime_error("cannot read the baseline " + filename);
+        }
+        nl::json j = nl::json::parse(in);
+        baseline_type res;
+        for (const auto& r : j.at("results"))
+        {
+            res[{r.at("variant").get<std::string>(), r.at("parameter").get<std::size_t>()}]
+                = r.at("runs").get<std::vector<double>>();
+        }
+        return res;
+    }
+
+    /***************************
+     * Implementation of bench *
+     ***************************/
+
+    bench::bench(cling::Interpreter* p)
+        : m_interpreter(p)
+    {
+        m_interpreter->declare("#include \"xcpp/xbench.hpp\"");
+    }
+
+    using count_type = double (*)(std::size_t);
+
+    // Compiles an expression of the parameter into a function, or returns
+    // nullptr if there is no expression.
+    static count_type
+    compile_count(cling::Interpreter* interpreter, const std::string& expr, const std::string& parameter)
+    {
+        if (trim(expr).empty())
+        {
+            return nullptr;
+        }
+        static std::size_t counter = 0;
+        std::string name = "__xcpp_bench_count_" + std::to_string(++counter);
+        std::string code = "extern \"C\" double " + name + "(std::size_t " + parameter + ")\n{\n";
+        code += "    return static_cast<double>(" + expr + ");\n}\n";
+        if (interpreter->declare(code) != cling::Interpreter::kSuccess)
+        {
+            throw std::runtime_error("cannot compile " + expr);
+        }
+        return reinterpret_cast<count_type>(interpreter->getAddressOfGlobal(name));
+    }
+
+    void bench::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("bench", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        std::size_t repeat = static_cast<std::size_t>(std::max(argpars.get<int>("-r"), 1));
+        double min_time = argpars.get<double>("-t");
+        double threshold = argpars.get<double>("--threshold");
+        std::string save = argpars.get<std::string>("--save");
+        std::string baseline_file = argpars.get<std::string>("--baseline");
+
+        try
+        {
+            std::string parameter = "_parameter";
+            std::vector<std::size_t> values = {0};
+            std::string spec = argpars.get<std::string>("-p");
+            bool has_parameter = !trim(spec).empty();
+            if (has_parameter)
+            {
+                values = parse_parameter(spec, parameter);
+            }
+
+            std::string setup;
+            std::vector<bench_variant> variants = parse_variants(cell, setup);
+            if (variants.empty())
+            {
+                std::cerr << "No variant given, start each of them with a line \"--- name\"" << std::endl;
+                return;
+            }
+
+            baseline_type baseline;
+            if (!baseline_file.empty())
+            {
+                baseline = load_baseline(baseline_file);
+            }
+
+            std::vector<timed_code> timed;
+            for (const auto& variant : variants)
+            {
+                timed.emplace_back(m_interpreter, variant.code, setup, parameter);
+                if (!timed.back().valid())
+                {
+                    std::cerr << "Cannot compile the variant " << variant.name << std::endl;
+                    return;
+                }
+            }
+            auto items = compile_count(m_interpreter, argpars.get<std::string>("--items"), parameter);
+            auto bytes = compile_count(m_interpreter, argpars.get<std::string>("--bytes"), parameter);
+
+            std::vector<bench_result> results;
+            for (std::size_t value : values)
+            {
+                // Warm-up and choice of the number of loops of each variant.
+                std::size_t nvariants = variants.size();
+                std::vector<std::size_t> loops(nvariants);
+                for (std::size_t v = 0; v < nvariants; ++v)
+                {
+                    timed[v](1, value);
+                    loops[v] = timed[v].autorange(min_time, value);
+                }
+
+                // The order of the variants is rotated at each repetition,
+                // so that a drift of the machine (frequency scaling, other
+                // processes) spreads over all of them.
+                std::vector<std::vector<double>> runs(nvariants);
+                for (std::size_t r = 0; r < repeat; ++r)
+                {
+                    for (std::size_t k = 0; k < nvariants; ++k)
+                    {
+                        std::size_t v = (k + r) % nvariants;
+                        runs[v].push_back(timed[v](loops[v], value) / loops[v]);
+                    }
+                }
+
+                for (std::size_t v = 0; v < nvariants; ++v)
+                {
+                    results.push_back({
+                        variants[v].name,
+                        value,
+                        make_timeit_result(loops[v], std::move(runs[v])),
+                        items ? items(value) : 0.,
+                        bytes ? bytes(value) : 0.
+                    });
+                }
+            }
+
+            std::vector<std::vector<std::string>> rows;
+            std::vector<std::string> header;
+            if (has_parameter)
+            {
+                header.push_back(parameter);
+            }
+            header.insert(header.end(), {"variant", "median", "+- std", "loops"});
+            if (items)
+            {
+                header.push_back("items/s");
+            }
+            if (bytes)
+            {
+                header.push_back("bytes/s");
+            }
+            header.insert(header.end(), {"speedup", "p-value"});
+            if (!baseline.empty())
+            {
+                header.push_back("vs baseline");
+            }
+            rows.push_back(header);
+
+            std::size_t regressions = 0;
+            const bench_result* reference = nullptr;
+            for (const auto& r : results)
+            {
+                if (reference == nullptr || reference->parameter != r.parameter)
+                {
+                    reference = &r;
+                }
+                const timeit_result& t = r.timing;
+
+                std::vector<std::string> row;
+                if (has_parameter)
+                {
+                    row.push_back(std::to_string(r.parameter));
+                }
+                row.insert(
+                    row.end(),
+                    {r.variant, format_timespan(t.median), format_timespan(t.stdev), std::to_string(t.loops)}
+                );
+                if (items)
+                {
+                    row.push_back(format_rate(r.items / t.median, false));
+                }
+                if (bytes)
+                {
+                    row.push_back(format_rate(r.bytes / t.median, true));
+                }
+                // Speedup and significance against the first variant.
+                row.push_back(format_double("%.2fx", reference->timing.median / t.median));
+                if (reference == &r)
+                {
+                    row.push_back("-");
+                }
+                else
+                {
+                    double p = mann_whitney(reference->timing.all_runs, t.all_runs);
+                    row.push_back(format_double("%.3g", p) + (p < 0.05 ? " *" : ""));
+                }
+                if (!baseline.empty())
+                {
+                    auto it = baseline.find({r.variant, r.parameter});
+                    if (it == baseline.end())
+                    {
+                        row.push_back("-");
+                    }
+                    else
+                    {
+                        std::vector<double> sorted = it->second;
+                        std::sort(sorted.begin(), sorted.end());
+                        double change = t.median / detail::median(sorted) - 1.;
+                        std::string cmp = format_double("%+.1f%%", 100. * change);
+                        if (change > threshold && mann_whitney(sorted, t.all_runs) < 0.05)
+                        {
+                            cmp += " REGRESSION";
+                            ++regressions;
+                        }
+                        row.push_back(cmp);
+                    }
+                }
+                rows.push_back(std::move(row));
+            }
+            print_table(rows);
+            std::cout << "* significantly different from " << variants.front().name << " (p < 0.05)"
+                      << std::endl;
+
+            if (!baseline.empty())
+            {
+                std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << " against "
+                          << baseline_file << std::endl;
+            }
+            if (!save.empty())
+            {
+                std::ofstream out(save);
+                out << to_json(has_parameter ? parameter : "", results).dump(4) << std::endl;
+                if (!out)
+                {
+                    std::cerr << "Cannot write the results to " << save << std::endl;
+                }
+            }
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    /**********************
+     * Autotuning parsing *
+     **********************/
+
+    struct tune_candidate
+    {
+        // One value per parameter.
+        std::vector<std::string> values;
+        const timed_code* timed;
+        std::size_t loops;
+        std::vector<double> runs;
+        bool pruned;
+    };
+
+    static void get_autotune_options(argparser& argpars)
+    {
+        argpars.add_description("Find the fastest values of the placeholders of C++ statements");
+        argpars.add_argument("-r", "--repeat")
+            .help("number of timed runs of each variant, interleaved with the runs of the other variants")
+            .default_value(5)
+            .scan<'i', int>();
+        argpars.add_argument("-t", "--min-time")
+            .help("minimum duration of a run in seconds, from which the number of loops is chosen")
+            .default_value(0.02)
+            .scan<'g', double>();
+        argpars.add_argument("--prune")
+            .help("stop timing the variants slower than the best one by this factor, 0 to time them all")
+            .default_value(1.5)
+            .scan<'g', double>();
+        argpars.add_argument("--no-declare")
+            .help("do not declare the fastest values in the session")
+            .default_value(false)
+            .implicit_value(true);
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    // The search space is given by the first lines of the cell, followed
+    // by the timed statements. A line "---" separates setup statements,
+    // which run before the clock starts, from the timed ones.
+    static std::vector<tune_parameter>
+    parse_tuning(const std::string& cell, std::string& setup, std::string& code)
+    {
+        std::vector<tune_parameter> res;
+        std::istringstream iss(cell);
+        std::string line;
+        bool in_header = true;
+        bool has_setup = false;
+        while (std::getline(iss, line))
+        {
+            tune_parameter parameter;
+            if (in_header && trim(line).empty())
+            {
+                continue;
+            }
+            else if (in_header && parse_search_space(line, parameter))
+            {
+                res.push_back(std::move(parameter));
+                continue;
+            }
+            in_header = false;
+            if (!has_setup && trim(line) == "---")
+            {
+                has_setup = true;
+                setup = code;
+                code.clear();
+            }
+            else
+            {
+                code += line + "\n";
+            }
+        }
+        return res;
+    }
+
+    static bool uses_identifier(const std::string& code, const std::string& name)
+    {
+        for (std::size_t pos = code.find(name); pos != std::string::npos; pos = code.find(name, pos + 1))
+        {
+            std::size_t end = pos + name.size();
+            if ((pos == 0 || !is_identifier_char(code[pos - 1]))
+                && (end == code.size() || !is_identifier_char(code[end])))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Variants which would compile to the same code are only timed once:
+    // repeated values are dropped, and so are the values of the
+    // placeholders which the code does not use.
+    static void deduplicate(std::vector<tune_parameter>& parameters, const std::string& code)
+    {
+        for (auto& parameter : parameters)
+        {
+            std::vector<std::string> values;
+            for (const auto& value : parameter.values)
+            {
+                if (std::find(values.begin(), values.end(), value) == values.end())
+                {
+                    values.push_back(value);
+                }
+            }
+            if (values.size() > 1 && !uses_identifier(code, parameter.name))
+            {
+                std::cerr << parameter.name << " is not used by the cell, only " << values.front()
+                          << " is tried" << std::endl;
+                values.resize(1);
+            }
+            parameter.values = std::move(values);
+        }
+    }
+
+    // All the combinations of values, the first parameter varying slowest.
+    static std::vector<std::vector<std::string>> combinations(const std::vector<tune_parameter>& parameters)
+    {
+        std::vector<std::vector<std::string>> res(1);
+        for (const auto& parameter : parameters)
+        {
+            std::vector<std::vector<std::string>> next;
+            for (const auto& prefix : res)
+            {
+                for (const auto& value : parameter.values)
+                {
+                    next.push_back(prefix);
+                    next.back().push_back(value);
+                }
+            }
+            res = std::move(next);
+        }
+        return res;
+    }
+
+    static std::string
+    declarations(const std::vector<tune_parameter>& parameters, const std::vector<std::string>& values)
+    {
+        std::string res;
+        for (std::size_t i = 0; i < parameters.size(); ++i)
+        {
+            res += "constexpr auto " + parameters[i].name + " = " + values[i] + ";\n";
+        }
+        return res;
+    }
+
+    static double median_run(const tune_candidate& candidate)
+    {
+        std::vector<double> sorted = candidate.runs;
+        std::sort(sorted.begin(), sorted.end());
+        return detail::median(sorted);
+    }
+
+    /******************************
+     * Implementation of autotune *
+     ******************************/
+
+    autotune::autotune(cling::Interpreter* p)
+        : m_interpreter(p)
+        , p_compiled(std::make_shared<std::map<std::string, timed_code>>())
+    {
+        m_interpreter->declare("#include <chrono>\n#include <cstddef>");
+    }
+
+    void autotune::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("autotune", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_autotune_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        std::size_t repeat = static_cast<std::size_t>(std::max(argpars.get<int>("-r"), 1));
+        double min_time = argpars.get<double>("-t");
+        // The best variant is never pruned.
+        double prune = argpars.get<double>("--prune");
+        prune = prune > 0. ? std::max(prune, 1.) : 0.;
+
+        try
+        {
+            std::string setup;
+            std::string code;
+            std::vector<tune_parameter> parameters = parse_tuning(cell, setup, code);
+            if (parameters.empty())
+            {
+                std::cerr << "No search space given, start the cell with lines \"NAME in {V1, V2, ...}\""
+                          << std::endl;
+                return;
+            }
+            if (trim(code).empty())
+            {
+                std::cerr << "No statement given to time" << std::endl;
+                return;
+            }
+            deduplicate(parameters, setup + code);
+
+            // Placeholders are constexpr variables of the timed function,
+            // they can be used as template arguments and array bounds.
+            std::vector<tune_candidate> candidates;
+            std::size_t failed = 0;
+            for (auto& values : combinations(parameters))
+            {
+                std::string decls = declarations(parameters, values);
+                std::string key = decls + setup + "\n---\n" + code;
+                auto it = p_compiled->find(key);
+                if (it == p_compiled->end())
+                {
+                    timed_code timed(m_interpreter, code, decls + setup);
+                    if (!timed.valid())
+                    {
+                        ++failed;
+                        continue;
+                    }
+                    it = p_compiled->emplace(std::move(key), timed).first;
+                }
+                candidates.push_back({std::move(values), &it->second, 0, {}, false});
+            }
+            if (candidates.empty())
+            {
+                std::cerr << "No variant could be compiled" << std::endl;
+                return;
+            }
+
+            for (auto& candidate : candidates)
+            {
+                (*candidate.timed)(1);
+                candidate.loops = candidate.timed->autorange(min_time);
+            }
+
+            // Interleaved rounds as in %%bench, after each of which the
+            // variants much slower than the best one are dropped.
+            std::size_t pruned = 0;
+            for (std::size_t r = 0; r < repeat; ++r)
+            {
+                std::size_t count = candidates.size();
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    tune_candidate& candidate = candidates[(k + r) % count];
+                    if (!candidate.pruned)
+                    {
+                        candidate.runs.push_back((*candidate.timed)(candidate.loops) / candidate.loops);
+                    }
+                }
+                if (prune <= 0.)
+                {
+                    continue;
+                }
+                double best = std::numeric_limits<double>::max();
+                for (const auto& candidate : candidates)
+                {
+                    if (!candidate.pruned)
+                    {
+                        best = std::min(best, median_run(candidate));
+                    }
+                }
+                for (auto& candidate : candidates)
+                {
+                    if (!candidate.pruned && median_run(candidate) > prune * best)
+                    {
+                        candidate.pruned = true;
+                        ++pruned;
+                    }
+                }
+            }
+
+            std::stable_sort(
+                candidates.begin(),
+                candidates.end(),
+                [](const tune_candidate& lhs, const tune_candidate& rhs)
+                {
+                    return lhs.pruned != rhs.pruned ? rhs.pruned : median_run(lhs) < median_run(rhs);
+                }
+            );
+
+            std::vector<std::vector<std::string>> rows;
+            std::vector<std::string> header;
+            for (const auto& parameter : parameters)
+            {
+                header.push_back(parameter.name);
+            }
+            header.insert(header.end(), {"median", "loops", "runs", "vs best"});
+            rows.push_back(header);
+            double best = median_run(candidates.front());
+            for (const auto& candidate : candidates)
+            {
+                std::vector<std::string> row = candidate.values;
+                double time = median_run(candidate);
+                row.insert(
+                    row.end(),
+                    {format_timespan(time),
+                     std::to_string(candidate.loops),
+                     std::to_string(candidate.runs.size()),
+                     format_double("%.2fx", time / best) + (candidate.pruned ? " pruned" : "")}
+                );
+                rows.push_back(std::move(row));
+            }
+            print_table(rows);
+            std::cout << candidates.size() << " variant" << (candidates.size() == 1 ? "" : "s") << " timed, "
+                      << pruned << " pruned, " << failed << " not compiled" << std::endl;
+
+            const tune_candidate& winner = candidates.front();
+            std::string decls = declarations(parameters, winner.values);
+            if (argpars["--no-declare"] == true)
+            {
+                std::cout << "Fastest:\n" << decls << std::flush;
+            }
+            else if (m_interpreter->declare(decls) == cling::Interpreter::kSuccess)
+            {
+                std::cout << "Declared:\n" << decls << std::flush;
+            }
+            else
+            {
+                std::cerr << "Cannot declare the fastest values, which may already be declared:\n"
+                          << decls << std::flush;
+            }
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
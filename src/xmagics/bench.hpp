@@ -0,0 +1,66 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_BENCH_HPP
+#define XMAGICS_BENCH_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    /**
+     * Compares named variants of a piece of code over a range of values of
+     * a parameter. The cell holds shared setup statements, followed by the
+     * variants, each introduced by a line "--- name".
+     */
+    class bench : public xmagic_cell
+    {
+    public:
+
+        bench(cling::Interpreter* p);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+    };
+
+    class timed_code;
+
+    /**
+     * Times the code of the cell for each combination of values of its
+     * placeholders, declared by lines "NAME in {V1, V2, ...}" at the top of
+     * the cell, and declares the fastest combination as constexpr
+     * variables.
+     */
+    class autotune : public xmagic_cell
+    {
+    public:
+
+        autotune(cling::Interpreter* p);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+        // Compiled variants by generated code, shared by the copies of the
+        // magic so that a variant is only compiled once per session.
+        std::shared_ptr<std::map<std::string, timed_code>> p_compiled;
+    };
+}
+#endif
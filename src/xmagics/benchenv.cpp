@@ -0,0 +1,108 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "xeus-cling/xoptions.hpp"
+
+#include "benchenv.hpp"
+#include "../xbenchenv.hpp"
+#include "../xparser.hpp"
+
+namespace xcpp
+{
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Show or change the settings of the kernel which affect the timing magics");
+        argpars.add_argument("--pin")
+            .help("pin the thread running the cells to the given CPU, or to a chosen one with auto")
+            .default_value(std::string(""));
+        argpars.add_argument("--unpin")
+            .help("restore the CPUs on which the threads of the kernel can run")
+            .default_value(false)
+            .implicit_value(true);
+        argpars.add_argument("--ftz")
+            .help("flush denormal floating-point numbers to zero (on) or not (off)")
+            .default_value(std::string(""));
+        argpars.add_argument("-r", "--runs")
+            .help("number of runs of the loop measuring the noise")
+            .default_value(20)
+            .scan<'i', int>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    void benchenv::operator()(const std::string& line)
+    {
+        argparser argpars("benchenv", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        bench_environment& environment = get_bench_environment();
+        if (argpars["--unpin"] == true)
+        {
+            environment.unpin();
+        }
+
+        std::string pin = trim(argpars.get<std::string>("--pin"));
+        if (!pin.empty())
+        {
+            int cpu = -1;
+            if (pin != "auto")
+            {
+                try
+                {
+                    cpu = std::stoi(pin);
+                }
+                catch (std::exception&)
+                {
+                    std::cerr << "Invalid CPU " << pin << ", expected a number or auto" << std::endl;
+                    return;
+                }
+            }
+            std::string message;
+            if (!environment.pin(cpu, message))
+            {
+                std::cerr << "Cannot pin the thread: " << message << std::endl;
+            }
+        }
+
+        std::string ftz = trim(argpars.get<std::string>("--ftz"));
+        if (!ftz.empty())
+        {
+            if (ftz != "on" && ftz != "off")
+            {
+                std::cerr << "Invalid value " << ftz << " for --ftz, expected on or off" << std::endl;
+                return;
+            }
+            if (!environment.set_flush_denormals(ftz == "on"))
+            {
+                std::cerr << "Denormals cannot be flushed to zero on this platform" << std::endl;
+            }
+        }
+
+        std::size_t runs = static_cast<std::size_t>(std::max(argpars.get<int>("-r"), 2));
+        std::cout << environment.report(noise_probe(runs)) << std::endl;
+    }
+}
@@ -0,0 +1,32 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_BENCHENV_HPP
+#define XMAGICS_BENCHENV_HPP
+
+#include <string>
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    /**
+     * Pins the thread running the cells, sets the flushing of denormals,
+     * and reports the state of the machine and the warnings which apply to
+     * the timing magics.
+     */
+    class benchenv : public xmagic_line
+    {
+    public:
+
+        virtual void operator()(const std::string& line) override;
+    };
+}
+#endif
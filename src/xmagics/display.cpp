@@ -0,0 +1,88 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "xeus-cling/xoptions.hpp"
+
+#include "xcpp/xdisplay_budget.hpp"
+
+#include "display.hpp"
+
+namespace xcpp
+{
+    display_budget& get_display_budget()
+    {
+        static display_budget budget;
+        return budget;
+    }
+
+    static void get_options(argparser &argpars)
+    {
+        argpars.add_description("Show or change the limits of the default representations of values");
+        argpars.add_argument("-e", "--max-elements")
+            .help("summarize containers with more than N elements")
+            .default_value(-1)
+            .scan<'i', int>();
+        argpars.add_argument("-t", "--edge-items")
+            .help("number of elements shown at the beginning and at the end of a summarized container")
+            .default_value(-1)
+            .scan<'i', int>();
+        argpars.add_argument("-d", "--max-depth")
+            .help("elide containers nested deeper than N levels")
+            .default_value(-1)
+            .scan<'i', int>();
+        argpars.add_argument("-b", "--max-bytes")
+            .help("cut text representations after N bytes")
+            .default_value(-1)
+            .scan<'i', int>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    static void update(std::size_t& value, int option)
+    {
+        if (option >= 0)
+        {
+            value = static_cast<std::size_t>(option);
+        }
+    }
+
+    void display_budget_magic::operator()(const std::string& line)
+    {
+        argparser argpars("display_budget", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        display_budget& budget = get_display_budget();
+        update(budget.max_elements, argpars.get<int>("-e"));
+        update(budget.edge_items, argpars.get<int>("-t"));
+        update(budget.max_depth, argpars.get<int>("-d"));
+        update(budget.max_bytes, argpars.get<int>("-b"));
+
+        std::cout << "max elements: " << budget.max_elements << "\n"
+                  << "edge items: " << budget.edge_items << "\n"
+                  << "max depth: " << budget.max_depth << "\n"
+                  << "max bytes: " << budget.max_bytes << "\n";
+    }
+}
@@ -0,0 +1,27 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_DISPLAY_HPP
+#define XMAGICS_DISPLAY_HPP
+
+#include <string>
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    class display_budget_magic : public xmagic_line
+    {
+    public:
+
+        virtual void operator()(const std::string& line) override;
+    };
+}
+#endif
@@ -8,26 +8,35 @@
 ************************************************************************************/
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <iterator>
 #include <fstream>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/DeclGroup.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/CodeGenOptions.h"
 #include "clang/Basic/DebugInfoOptions.h"
+#include "clang/Basic/LangOptions.h"
 #include "clang/Basic/Sanitizers.h"
 #include "clang/Basic/TargetInfo.h"
+#include "clang/Basic/TargetOptions.h"
 #include "clang/CodeGen/BackendUtil.h"
 #include "clang/CodeGen/ModuleBuilder.h"
 #include "clang/Frontend/CompilerInstance.h"
@@ -36,6 +45,8 @@
 
 #include "xeus-cling/xoptions.hpp"
 
+#include "xcpp/xtimeit.hpp"
+
 #include "../xparser.hpp"
 
 #include "executable.hpp"
@@ -56,6 +67,10 @@ namespace xcpp
             .help("linker options: enable instrumentation with ThreadSanitizer using \'-fsanitize=thread\'")
             .default_value(false)
             .implicit_value(true);
+        argpars.add_argument("-j", "--jobs")
+            .help("number of processes generating the object code, 0 for one per core. Default: 1")
+            .default_value(1)
+            .scan<'i', int>();
         // Add custom help (does not call `exit` avoiding to restart the kernel)
         argpars.add_argument("-h", "--help")
             .action([&](const std::string & /*unused*/)
@@ -135,7 +150,19 @@ namespace xcpp
         clang::ASTConsumer* m_consumer;
     };
 
-    bool executable::generate_obj(std::string& ObjectFile, bool EnableDebugInfo)
+    // clang++ of the installation of cling, which links the executable.
+    static llvm::SmallString<256> get_compiler(const clang::HeaderSearchOptions& HeaderSearchOpts)
+    {
+        llvm::StringRef InstallDir = llvm::sys::path::parent_path(
+            llvm::sys::path::parent_path(
+                llvm::sys::path::parent_path(HeaderSearchOpts.ResourceDir)));
+        llvm::SmallString<256> Compiler(InstallDir);
+        llvm::sys::path::append(Compiler, "bin", "clang++");
+        return Compiler;
+    }
+
+    bool executable::generate_obj(std::vector<std::string>& ObjectFiles,
+                                  bool EnableDebugInfo, unsigned Jobs)
     {
         // Generate LLVM IR for current AST.
         auto* CI = m_interpreter.getCI();
@@ -164,46 +191,140 @@ namespace xcpp
 
         CG->HandleTranslationUnit(AST);
 
-        // Generate (temporary) object code from LLVM IR.
-        int ObjectFD;
-        llvm::SmallString<64> ObjectFilePath;
-        std::error_code EC = llvm::sys::fs::createTemporaryFile(
-            "object", "o", ObjectFD, ObjectFilePath);
-        if (EC)
+        auto DataLayout = AST.getTargetInfo().getDataLayout();
+        if (Jobs == 1)
         {
-            std::cerr << "Could not create temporary object file:" << std::endl
-                      << EC.message() << std::endl;
-            return false;
-        }
-        ObjectFile = ObjectFilePath.str();
+            // Generate (temporary) object code from LLVM IR.
+            int ObjectFD;
+            llvm::SmallString<64> ObjectFilePath;
+            std::error_code EC = llvm::sys::fs::createTemporaryFile(
+                "object", "o", ObjectFD, ObjectFilePath);
+            if (EC)
+            {
+                std::cerr << "Could not create temporary object file:" << std::endl
+                          << EC.message() << std::endl;
+                return false;
+            }
+            ObjectFiles.push_back(ObjectFilePath.str());
 
-        std::unique_ptr<llvm::raw_pwrite_stream> OS(
-            new llvm::raw_fd_ostream(ObjectFD, true));
+            std::unique_ptr<llvm::raw_pwrite_stream> OS(
+                new llvm::raw_fd_ostream(ObjectFD, true));
 
-        auto DataLayout = AST.getTargetInfo().getDataLayout();
+            EmitBackendOutput(CI->getDiagnostics(), HeaderSearchOpts,
+                              CodeGenOpts, CI->getTargetOpts(),
+                              CI->getLangOpts(), DataLayout, CG->GetModule(),
+                              clang::Backend_EmitObj, std::move(OS));
+            return true;
+        }
+
+        // Run the optimization and instrumentation passes on the whole
+        // module, then split it and write the partitions as bitcode.
         EmitBackendOutput(CI->getDiagnostics(), HeaderSearchOpts,
                           CodeGenOpts, CI->getTargetOpts(),
                           CI->getLangOpts(), DataLayout, CG->GetModule(),
-                          clang::Backend_EmitObj, std::move(OS));
-        return true;
+                          clang::Backend_EmitNothing, nullptr);
+
+        std::vector<std::string> BitcodeFiles;
+        std::vector<std::unique_ptr<llvm::FileRemover>> BitcodeRemovers;
+        bool Written = true;
+        auto WritePartition = [&](std::unique_ptr<llvm::Module> Partition)
+        {
+            int BitcodeFD;
+            llvm::SmallString<64> BitcodeFilePath;
+            std::error_code EC = llvm::sys::fs::createTemporaryFile(
+                "partition", "bc", BitcodeFD, BitcodeFilePath);
+            if (EC)
+            {
+                std::cerr << "Could not create temporary bitcode file:" << std::endl
+                          << EC.message() << std::endl;
+                Written = false;
+                return;
+            }
+            BitcodeFiles.push_back(BitcodeFilePath.str());
+            BitcodeRemovers.emplace_back(new llvm::FileRemover(BitcodeFiles.back()));
+            llvm::raw_fd_ostream OS(BitcodeFD, true);
+            llvm::WriteBitcodeToFile(*Partition, OS);
+        };
+#if LLVM_VERSION_MAJOR < 13
+        llvm::SplitModule(std::unique_ptr<llvm::Module>(CG->ReleaseModule()), Jobs, WritePartition);
+#else
+        llvm::SplitModule(*CG->GetModule(), Jobs, WritePartition);
+#endif
+        if (!Written)
+        {
+            return false;
+        }
+
+        // Generate the object code of the partitions with concurrent clang
+        // processes, which set up the target as for the whole module. The
+        // passes already ran, only the code generator runs on the bitcode.
+        llvm::SmallString<256> Compiler = get_compiler(HeaderSearchOpts);
+        std::string OptLevel = "-O" + std::to_string(CodeGenOpts.OptimizationLevel);
+        std::vector<llvm::sys::ProcessInfo> Processes;
+        std::vector<std::string> ErrorFiles;
+        std::vector<std::unique_ptr<llvm::FileRemover>> ErrorRemovers;
+        for (std::size_t I = 0; I < BitcodeFiles.size(); ++I)
+        {
+            llvm::SmallString<64> ErrorFile;
+            llvm::sys::fs::createTemporaryFile("partition", "err", ErrorFile);
+            ErrorFiles.push_back(ErrorFile.str());
+            ErrorRemovers.emplace_back(new llvm::FileRemover(ErrorFiles.back()));
+
+            llvm::SmallString<64> ObjectFile;
+            llvm::sys::fs::createTemporaryFile("object", "o", ObjectFile);
+            ObjectFiles.push_back(ObjectFile.str());
+
+            llvm::SmallVector<llvm::StringRef, 16> Args = {
+                Compiler.c_str(), "-c", BitcodeFiles[I], "-o", ObjectFiles.back(),
+                "-fPIC", OptLevel, "-Xclang", "-disable-llvm-passes"};
+            llvm::StringRef ErrorFileStr(ErrorFiles.back());
+            llvm::SmallVector<llvm::Optional<llvm::StringRef>, 16> Redirects = {llvm::NoneType::None, llvm::NoneType::None, ErrorFileStr};
+            std::string ErrorMessage;
+            Processes.push_back(llvm::sys::ExecuteNoWait(Compiler, Args, llvm::NoneType::None,
+                                                         Redirects, 0, &ErrorMessage));
+            if (Processes.back().Pid == 0)
+            {
+                std::cerr << "Could not run " << Compiler.str().str() << ":" << std::endl
+                          << ErrorMessage << std::endl;
+                Processes.pop_back();
+                break;
+            }
+        }
+
+        // The object files are linked in the order of the partitions, so
+        // that the executable does not depend on the scheduling.
+        bool Generated = Processes.size() == BitcodeFiles.size();
+        for (std::size_t I = 0; I < Processes.size(); ++I)
+        {
+            llvm::sys::ProcessInfo Result = llvm::sys::Wait(Processes[I], 0, true);
+            auto ErrorBuf = llvm::MemoryBuffer::getFile(ErrorFiles[I]);
+            if (ErrorBuf && !ErrorBuf.get()->getBuffer().empty())
+            {
+                std::cerr << ErrorBuf.get()->getBuffer().str();
+            }
+            if (Result.ReturnCode != 0)
+            {
+                std::cerr << "Could not generate the object code of partition " << I << std::endl;
+                Generated = false;
+            }
+        }
+        return Generated;
     }
 
-    bool executable::generate_exe(const std::string& ObjectFile,
+    bool executable::generate_exe(const std::vector<std::string>& ObjectFiles,
                                   const std::string& ExeFile,
                                   const std::vector<std::string>& LinkerOptions)
     {
-        auto& HeaderSearchOpts = m_interpreter.getCI()->getHeaderSearchOpts();
         // Generate executable by linking the created object code.
-        llvm::StringRef InstallDir = llvm::sys::path::parent_path(
-            llvm::sys::path::parent_path(
-                llvm::sys::path::parent_path(HeaderSearchOpts.ResourceDir)));
-        llvm::SmallString<256> Compiler(InstallDir);
-        llvm::sys::path::append(Compiler, "bin", "clang++");
+        llvm::SmallString<256> Compiler = get_compiler(m_interpreter.getCI()->getHeaderSearchOpts());
 
         // Construct arguments to linker command.
         llvm::SmallVector<llvm::StringRef, 16> Args;
         Args.push_back(Compiler.c_str());
-        Args.push_back(ObjectFile.c_str());
+        for (auto& F : ObjectFiles)
+        {
+            Args.push_back(F.c_str());
+        }
         for (auto& O : LinkerOptions)
         {
             Args.push_back(O.c_str());
@@ -326,17 +447,33 @@ namespace xcpp
             LinkerOptions.push_back("-fsanitize=thread");
         }
 
+        int JobsOption = argpars.get<int>("-j");
+        unsigned Jobs = JobsOption != 0 ? static_cast<unsigned>(std::max(JobsOption, 1))
+                                        : std::thread::hardware_concurrency();
+        Jobs = std::max(Jobs, 1u);
+
         std::cout << "Writing executable to " << ExeFile << std::endl;
 
-        std::string ObjectFile;
-        if (!generate_obj(ObjectFile, EnableDebugInfo))
+        std::vector<std::string> ObjectFiles;
+        auto Start = std::chrono::steady_clock::now();
+        bool Generated = generate_obj(ObjectFiles, EnableDebugInfo, Jobs);
+        // Cleanup after we exit.
+        std::vector<std::unique_ptr<llvm::FileRemover>> ObjectRemovers;
+        for (auto& F : ObjectFiles)
+        {
+            ObjectRemovers.emplace_back(new llvm::FileRemover(F));
+        }
+        if (!Generated)
         {
             return;
         }
-        // Cleanup after we exit.
-        llvm::FileRemover ObjectRemover(ObjectFile);
+        std::chrono::duration<double> Elapsed =
+            std::chrono::steady_clock::now() - Start;
+        std::cout << "Generated object code in " << format_timespan(Elapsed.count())
+                  << " on " << Jobs << (Jobs == 1 ? " process" : " processes")
+                  << std::endl;
 
-        generate_exe(ObjectFile, ExeFile, LinkerOptions);
+        generate_exe(ObjectFiles, ExeFile, LinkerOptions);
 
         if (SanitizeThread)
         {
@@ -31,8 +31,9 @@ namespace xcpp
 
         std::string generate_fns(const std::string& cell, std::string& main,
                                  std::string& unique_fn);
-        bool generate_obj(std::string& ObjectFile, bool EnableDebugInfo);
-        bool generate_exe(const std::string& ObjectFile,
+        bool generate_obj(std::vector<std::string>& ObjectFiles,
+                          bool EnableDebugInfo, unsigned Jobs);
+        bool generate_exe(const std::vector<std::string>& ObjectFiles,
                           const std::string& ExeFile,
                           const std::vector<std::string>& LinkerOptions);
 
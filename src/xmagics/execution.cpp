@@ -7,10 +7,12 @@
 * The full license is in the file LICENSE, distributed with this software.         *
 ************************************************************************************/
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "cling/Interpreter/Value.h"
@@ -19,18 +21,83 @@
 #include "cling/Utils/Output.h"
 
 #include "execution.hpp"
+#include "../xbenchenv.hpp"
 #include "../xparser.hpp"
 
 namespace xcpp
 {
+    /********************************
+     * Implementation of timed_code *
+     ********************************/
+
+    timed_code::timed_code(
+        cling::Interpreter* p,
+        const std::string& code,
+        const std::string& setup,
+        const std::string& parameter
+    )
+        : p_function(nullptr)
+    {
+        static std::size_t counter = 0;
+        std::string name = "__xcpp_timeit_" + std::to_string(++counter);
+
+        // The trailing semicolons allow an expression without one, as in
+        // "%timeit f(x)".
+        std::string function_code = "extern \"C\" double " + name + "(std::size_t _number, std::size_t "
+                                    + parameter + ")\n{\n";
+        function_code += setup + "\n;\n";
+        function_code += "    auto _t0 = std::chrono::steady_clock::now();\n";
+        function_code += "    for (std::size_t _i = 0; _i < _number; ++_i)\n    {\n";
+        function_code += code + "\n;\n";
+        function_code += "    }\n";
+        function_code += "    auto _t1 = std::chrono::steady_clock::now();\n";
+        function_code += "    return std::chrono::duration<double>(_t1 - _t0).count();\n}\n";
+
+        // The transaction is kept: the function may instantiate templates
+        // that are used by later cells.
+        if (p->declare(function_code) == cling::Interpreter::kSuccess)
+        {
+            p_function = reinterpret_cast<function_type>(p->getAddressOfGlobal(name));
+        }
+    }
+
+    bool timed_code::valid() const
+    {
+        return p_function != nullptr;
+    }
+
+    double timed_code::operator()(std::size_t number, std::size_t parameter) const
+    {
+        return p_function(number, parameter);
+    }
+
+    std::size_t timed_code::autorange(double min_time, std::size_t parameter) const
+    {
+        // Same sequence as IPython.
+        std::size_t number = 1;
+        for (std::size_t scale = 1; scale <= 1000000000; scale *= 10)
+        {
+            for (std::size_t base : {1, 2, 5})
+            {
+                number = base * scale;
+                if ((*this)(number, parameter) >= min_time)
+                {
+                    return number;
+                }
+            }
+        }
+        return number;
+    }
+
+    /****************************
+     * Implementation of timeit *
+     ****************************/
+
     timeit::timeit(cling::Interpreter* p)
         : m_interpreter(p)
+        , p_result(nullptr)
     {
-        cling::Interpreter::CompilationResult compilation_result;
-        compilation_result = m_interpreter->process("#include <chrono>");
-        std::string init_timeit = "auto _t0 = std::chrono::high_resolution_clock::now();\n";
-        init_timeit += "auto _t1 = std::chrono::high_resolution_clock::now();\n";
-        compilation_result = m_interpreter->process(init_timeit.c_str());
+        m_interpreter->declare("#include <chrono>\n#include <cstddef>");
     }
 
     void timeit::get_options(argparser &argpars)
@@ -48,6 +115,10 @@ namespace xcpp
             .help("use a precision of p digits to display the timing result")
             .default_value(3)
             .scan<'i', int>();
+        argpars.add_argument("-o", "--output")
+            .help("store the result in the _timeit_result variable, an xcpp::timeit_result")
+            .default_value(false)
+            .implicit_value(true);
         argpars.add_argument("expression")
             .help("expression to be evaluated")
             .remaining();
@@ -63,36 +134,32 @@ namespace xcpp
             .nargs(0);
     }
 
-    std::string timeit::inner(std::size_t number, const std::string& code) const
+    std::string timeit::_format_time(double timespan, std::size_t precision) const
     {
-        std::string timeit_code = "";
-        timeit_code += "_t0 = std::chrono::high_resolution_clock::now();\n";
-        timeit_code += "for (std::size_t _i = 0; _i < " + std::to_string(number) + "; ++_i) {\n";
-        timeit_code += "   " + code + "\n";
-        timeit_code += "}\n";
-        timeit_code += "_t1 = std::chrono::high_resolution_clock::now();\n";
-        timeit_code += "std::chrono::duration<double>(_t1-_t0).count();";
-        return timeit_code;
+        return format_timespan(timespan, precision);
     }
 
-    std::string timeit::_format_time(double timespan, std::size_t precision) const
+    void timeit::store_result(const timeit_result& result)
     {
-        std::vector<std::string> units{"s", "ms", "us", "ns"};
-        std::vector<double> scaling{1, 1e3, 1e6, 1e9};
-        std::ostringstream output;
-        int order;
-
-        if (timespan > 0.0)
-        {
-            order = std::min(-static_cast<int>(std::floor(std::floor(std::log10(timespan)) / 3)), 3);
-        }
-        else
+        if (p_result == nullptr)
         {
-            order = 3;
+            std::string code = "#include \"xcpp/xtimeit.hpp\"\n";
+            code += "xcpp::timeit_result _timeit_result;\n";
+            code += "extern \"C\" void* __xcpp_timeit_result() { return &_timeit_result; }\n";
+            if (m_interpreter->declare(code) != cling::Interpreter::kSuccess)
+            {
+                return;
+            }
+            using getter_type = void* (*)();
+            void* address = m_interpreter->getAddressOfGlobal("__xcpp_timeit_result");
+            auto getter = reinterpret_cast<getter_type>(address);
+            if (getter == nullptr)
+            {
+                return;
+            }
+            p_result = static_cast<timeit_result*>(getter());
         }
-        output.precision(precision);
-        output << timespan * scaling[order] << " " << units[order];
-        return output.str();
+        *p_result = result;
     }
 
     void timeit::execute(std::string& line, std::string& cell)
@@ -105,10 +172,16 @@ namespace xcpp
         get_options(argpars);
         argpars.parse(line);
 
-        // TODO find a way to use std::size_t
         int number = argpars.get<int>("-n");
         int repeat = argpars.get<int>("-r");
         int precision = argpars.get<int>("-p");
+        if (number < 0 || repeat < 1)
+        {
+            std::cerr << "The number of loops cannot be negative and the number of runs must be positive"
+                      << std::endl;
+            return;
+        }
+        std::size_t runs = static_cast<std::size_t>(std::max(repeat, 1));
 
         std::string code;
         try
@@ -136,45 +209,47 @@ namespace xcpp
         auto errorlevel = 0;
         std::string ename;
         std::string evalue;
-        cling::Value output;
         cling::Interpreter::CompilationResult compilation_result = cling::Interpreter::kSuccess;
 
         try
         {
-            if (number == 0)
+            timed_code timed(m_interpreter, code);
+            if (!timed.valid())
+            {
+                compilation_result = cling::Interpreter::kFailure;
+            }
+            else
             {
-                for (std::size_t n = 0; n < 10; ++n)
+                // Warm-up run, which pays for the lazy emission of the code
+                // and the first touch of its data.
+                timed(1);
+
+                std::size_t loops = number > 0 ? static_cast<std::size_t>(number) : timed.autorange(0.2);
+                std::vector<double> all_runs;
+                all_runs.reserve(runs);
+                for (std::size_t r = 0; r < runs; ++r)
                 {
-                    number = std::pow(10, n);
-                    std::string timeit_code = inner(number, code);
-                    compilation_result = m_interpreter->process(timeit_code.c_str(), &output);
-                    if (output.simplisticCastAs<double>() >= 0.2)
-                    {
-                        break;
-                    }
+                    all_runs.push_back(timed(loops) / loops);
                 }
-            }
+                timeit_result result = make_timeit_result(loops, std::move(all_runs));
+                const bench_environment& environment = get_bench_environment();
+                result.environment = environment.describe();
 
-            std::vector<double> all_runs;
-            double mean = 0;
-            double stdev = 0;
-            for (std::size_t r = 0; r < static_cast<std::size_t>(repeat); ++r)
-            {
-                std::string timeit_code = inner(number, code);
-                compilation_result = m_interpreter->process(timeit_code.c_str(), &output);
-                all_runs.push_back(output.simplisticCastAs<double>() / number);
-                mean += all_runs.back();
-            }
-            mean /= repeat;
-            for (std::size_t r = 0; r < static_cast<std::size_t>(repeat); ++r)
-            {
-                stdev += (all_runs[r] - mean) * (all_runs[r] - mean);
-            }
-            stdev = std::sqrt(stdev / repeat);
+                std::cout << _format_time(result.mean, precision) << " +- "
+                          << _format_time(result.stdev, precision);
+                std::cout << " per loop (mean +- std. dev. of " << repeat << " run"
+                          << ((repeat == 1) ? ", " : "s ");
+                std::cout << loops << " loop" << ((loops == 1) ? "" : "s") << " each)" << std::endl;
+                std::cout << "min " << _format_time(result.best, precision) << ", median "
+                          << _format_time(result.median, precision) << ", p95 "
+                          << _format_time(result.p95, precision) << std::endl;
+                print_environment(environment);
 
-            std::cout << _format_time(mean, precision) << " +- " << _format_time(stdev, precision);
-            std::cout << " per loop (mean +- std. dev. of " << repeat << " run" << ((repeat == 1) ? ", " : "s ");
-            std::cout << number << " loop" << ((number == 1) ? "" : "s") << " each)" << std::endl;
+                if (argpars["-o"] == true)
+                {
+                    store_result(result);
+                }
+            }
         }
         // Catch all errors
         catch (cling::InterpreterException& e)
@@ -18,8 +18,43 @@
 #include "xeus-cling/xmagics.hpp"
 #include "xeus-cling/xoptions.hpp"
 
+#include "xcpp/xtimeit.hpp"
+
 namespace xcpp
 {
+    /**
+     * Statements compiled once into a function which runs them in a loop,
+     * so that they can be timed any number of times without invoking the
+     * interpreter again. The setup statements run before the clock starts,
+     * and both can use the parameter of the function, of type std::size_t.
+     */
+    class timed_code
+    {
+    public:
+
+        using function_type = double (*)(std::size_t, std::size_t);
+
+        timed_code(
+            cling::Interpreter* p,
+            const std::string& code,
+            const std::string& setup = "",
+            const std::string& parameter = "_parameter"
+        );
+
+        bool valid() const;
+
+        // Runs the statements number times and returns the elapsed time in seconds.
+        double operator()(std::size_t number, std::size_t parameter = 0) const;
+
+        // Smallest number of loops in the sequence 1, 2, 5, 10, 20, 50, ...
+        // which takes at least min_time seconds.
+        std::size_t autorange(double min_time, std::size_t parameter = 0) const;
+
+    private:
+
+        function_type p_function;
+    };
+
     class timeit : public xmagic_line_cell
     {
     public:
@@ -43,10 +78,11 @@ namespace xcpp
     private:
 
         cling::Interpreter* m_interpreter;
+        timeit_result* p_result;
 
         void get_options(argparser &argpars);
-        std::string inner(std::size_t number, const std::string& code) const;
         std::string _format_time(double timespan, std::size_t precision) const;
+        void store_result(const timeit_result& result);
         void execute(std::string& line, std::string& cell);
     };
 }
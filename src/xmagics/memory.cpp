@@ -0,0 +1,115 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "memory.hpp"
+#include "../xmemory.hpp"
+#include "../xparser.hpp"
+
+namespace xcpp
+{
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Measure the memory used by a C++ statement or by a cell");
+        argpars.add_argument("--always")
+            .help("report the memory used by every cell in the execute replies")
+            .default_value(false)
+            .implicit_value(true);
+        argpars.add_argument("--off")
+            .help("stop reporting the memory used by every cell")
+            .default_value(false)
+            .implicit_value(true);
+        argpars.add_argument("statement")
+            .help("statement to be executed")
+            .remaining();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    memit::memit(cling::Interpreter* p, bool* track_cells)
+        : m_interpreter(p)
+        , p_track_cells(track_cells)
+    {
+    }
+
+    void memit::execute(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("memit", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+        if (argpars["--always"] == true || argpars["--off"] == true)
+        {
+            *p_track_cells = argpars["--always"] == true;
+            std::cout << "Memory accounting of every cell " << (*p_track_cells ? "enabled" : "disabled")
+                      << std::endl;
+            return;
+        }
+
+        std::string code;
+        try
+        {
+            const auto& v = argpars.get<std::vector<std::string>>("statement");
+            for (const auto& s : v)
+            {
+                code += " " + s;
+            }
+        }
+        catch (std::logic_error&)
+        {
+            // No statement on the line of a cell magic.
+        }
+        if (!code.empty() && !cell.empty())
+        {
+            code += "\n";
+        }
+        code += cell;
+        if (trim(code).empty())
+        {
+            std::cerr << "No statement given to execute" << std::endl;
+            return;
+        }
+
+        memory_tracker tracker;
+        tracker.start();
+        try
+        {
+            m_interpreter->process(code);
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        std::cout << tracker.stop().report() << std::endl;
+    }
+}
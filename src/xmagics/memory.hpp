@@ -0,0 +1,52 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_MEMORY_HPP
+#define XMAGICS_MEMORY_HPP
+
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    /**
+     * Runs a statement or a cell once and reports its peak resident memory,
+     * the change of the resident set size and the heap it left allocated.
+     * Also turns on and off the accounting of every cell, whose result is
+     * added to the execute replies.
+     */
+    class memit : public xmagic_line_cell
+    {
+    public:
+
+        memit(cling::Interpreter* p, bool* track_cells);
+
+        virtual void operator()(const std::string& line) override
+        {
+            execute(line, "");
+        }
+
+        virtual void operator()(const std::string& line, const std::string& cell) override
+        {
+            execute(line, cell);
+        }
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+        bool* p_track_cells;
+
+        void execute(const std::string& line, const std::string& cell);
+    };
+}
+#endif
@@ -0,0 +1,100 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "optimize.hpp"
+#include "../xoptimization.hpp"
+
+namespace xcpp
+{
+    /******************************
+     * Implementation of optimize *
+     ******************************/
+
+    optimize::optimize(cling::Interpreter* p, execute_type execute, optimization_settings* cell_settings)
+        : m_interpreter(p)
+        , m_execute(std::move(execute))
+        , p_cell_settings(cell_settings)
+    {
+    }
+
+    void optimize::get_options(argparser& argpars)
+    {
+        argpars.add_description("Execute C++ statements compiled with the given optimizations");
+        for (int level = 0; level <= 3; ++level)
+        {
+            argpars.add_argument("-O" + std::to_string(level))
+                .help("optimization level " + std::to_string(level) + (level == 2 ? " (default)" : ""))
+                .default_value(false)
+                .implicit_value(true);
+        }
+        argpars.add_argument("-march")
+            .help("generate code for the features of the host CPU with -march=native")
+            .default_value(std::string(""));
+        argpars.add_argument("-ffast-math")
+            .help("allow floating-point optimizations which break IEEE semantics")
+            .default_value(false)
+            .implicit_value(true);
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    void optimize::operator()(const std::string& line, const std::string& cell)
+    {
+        // Accepts -march=native as a compiler does.
+        std::string cline = line;
+        std::size_t pos = cline.find("-march=");
+        if (pos != std::string::npos)
+        {
+            cline[pos + 6] = ' ';
+        }
+
+        argparser argpars("optimize", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(cline);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        optimization_settings settings = current_optimization(*m_interpreter);
+        settings.level = 2;
+        for (int level = 0; level <= 3; ++level)
+        {
+            if (argpars["-O" + std::to_string(level)] == true)
+            {
+                settings.level = level;
+            }
+        }
+        std::string march = argpars.get<std::string>("-march");
+        if (!march.empty() && march != "native")
+        {
+            std::cerr << "Unsupported -march=" << march << ", only native is supported" << std::endl;
+            return;
+        }
+        settings.native = settings.native || march == "native";
+        settings.fast_math = settings.fast_math || argpars["-ffast-math"] == true;
+
+        optimization_scope scope(*m_interpreter, settings);
+        *p_cell_settings = settings;
+        m_execute(cell);
+    }
+}
@@ -0,0 +1,50 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_OPTIMIZE_HPP
+#define XMAGICS_OPTIMIZE_HPP
+
+#include <functional>
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    struct optimization_settings;
+
+    /**
+     * Runs the cell as a regular cell, with its code optimized at the
+     * given level and optionally for the host CPU and with fast-math.
+     * The settings in effect are written to cell_settings, which the
+     * kernel reports in the reply to the cell.
+     */
+    class optimize : public xmagic_cell
+    {
+    public:
+
+        using execute_type = std::function<void(const std::string&)>;
+
+        optimize(cling::Interpreter* p, execute_type execute, optimization_settings* cell_settings);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+        execute_type m_execute;
+        optimization_settings* p_cell_settings;
+
+        void get_options(argparser& argpars);
+    };
+}
+#endif
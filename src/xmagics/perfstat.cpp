@@ -0,0 +1,182 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xcpp/xtimeit.hpp"
+
+#include "execution.hpp"
+#include "perfstat.hpp"
+#include "../xbenchenv.hpp"
+#include "../xparser.hpp"
+#include "../xperf_events.hpp"
+
+namespace xcpp
+{
+    /******************************
+     * Implementation of perfstat *
+     ******************************/
+
+    perfstat::perfstat(cling::Interpreter* p)
+        : m_interpreter(p)
+    {
+    }
+
+    void perfstat::get_options(argparser& argpars)
+    {
+        argpars.add_description("Count hardware and software events during the execution of C++ statements");
+        argpars.add_argument("-n", "--number")
+            .help("execute the statements n times in a loop, chosen automatically if not given")
+            .default_value(0)
+            .scan<'i', int>();
+        argpars.add_argument("-r", "--repeat")
+            .help("count the events over r executions of the loop")
+            .default_value(1)
+            .scan<'i', int>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    static std::string format_count(const char* format, double value)
+    {
+        char buf[64];
+        std::snprintf(buf, sizeof(buf), format, value);
+        return buf;
+    }
+
+    static void print_count(const std::string& name, const std::string& per_loop, const std::string& total)
+    {
+        char buf[256];
+        std::snprintf(buf, sizeof(buf), "%-24s %16s %16s", name.c_str(), per_loop.c_str(), total.c_str());
+        std::cout << buf;
+    }
+
+    void perfstat::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("perfstat", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true || trim(cell).empty())
+        {
+            return;
+        }
+        int number = argpars.get<int>("-n");
+        std::size_t repeat = static_cast<std::size_t>(std::max(argpars.get<int>("-r"), 1));
+
+        try
+        {
+            timed_code timed(m_interpreter, cell);
+            if (!timed.valid())
+            {
+                return;
+            }
+            timed(1);
+            std::size_t loops = number > 0 ? static_cast<std::size_t>(number) : timed.autorange(0.2);
+
+            // Opened after the calibration, so that only the measured runs
+            // are counted.
+            perf_counters counters;
+            double wall_time = 0.;
+            for (std::size_t r = 0; r < repeat; ++r)
+            {
+                counters.start();
+                wall_time += timed(loops);
+                counters.stop();
+            }
+            std::vector<perf_count> counts = counters.read();
+            double calls = static_cast<double>(loops * repeat);
+
+            auto find = [&counts](const std::string& name) -> const perf_count*
+            {
+                for (const auto& c : counts)
+                {
+                    if (c.name == name && c.running > 0.)
+                    {
+                        return &c;
+                    }
+                }
+                return nullptr;
+            };
+
+            std::cout << loops << " loop" << (loops == 1 ? "" : "s") << ", " << repeat << " run"
+                      << (repeat == 1 ? "" : "s") << "\n\n";
+            print_count("", "per loop", "total");
+            std::cout << "\n";
+            print_count("wall time", format_timespan(wall_time / calls), format_timespan(wall_time));
+            std::cout << "\n";
+            for (const auto& c : counts)
+            {
+                if (c.running == 0.)
+                {
+                    print_count(c.name, "<not counted>", "");
+                }
+                else if (c.name == "task-clock")
+                {
+                    double seconds = c.value * 1e-9;
+                    print_count(c.name, format_timespan(seconds / calls), format_timespan(seconds));
+                }
+                else
+                {
+                    print_count(c.name, format_count("%.4g", c.value / calls), format_count("%.0f", c.value));
+                }
+
+                // Derived metrics, as perf stat shows them.
+                const perf_count* cycles = find("cycles");
+                const perf_count* branches = find("branches");
+                if (c.name == "instructions" && cycles != nullptr && cycles->value > 0.)
+                {
+                    std::cout << "  # " << format_count("%.2f", c.value / cycles->value) << " IPC";
+                }
+                else if (c.name == "branch-misses" && branches != nullptr && branches->value > 0.)
+                {
+                    std::cout << "  # " << format_count("%.2f", 100. * c.value / branches->value)
+                              << "% of branches";
+                }
+                if (c.running > 0. && c.running < 1.)
+                {
+                    std::cout << "  (" << format_count("%.0f", 100. * c.running) << "% of the time)";
+                }
+                std::cout << "\n";
+            }
+            if (!counters.message().empty())
+            {
+                std::cout << "\nnote: " << counters.message() << "\n";
+            }
+            std::cout << std::flush;
+            print_environment(get_bench_environment());
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
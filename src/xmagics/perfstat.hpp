@@ -0,0 +1,41 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_PERFSTAT_HPP
+#define XMAGICS_PERFSTAT_HPP
+
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    /**
+     * Runs the cell in the loop of %timeit, under the counters of
+     * perf_counters, and reports them per loop.
+     */
+    class perfstat : public xmagic_cell
+    {
+    public:
+
+        perfstat(cling::Interpreter* p);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+
+        void get_options(argparser& argpars);
+    };
+}
+#endif
@@ -0,0 +1,410 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xcpp/xdisplay.hpp"
+#include "xcpp/xhtml.hpp"
+
+#include "profile.hpp"
+#include "../xparser.hpp"
+#include "../xsampler.hpp"
+#include "../xsymbolizer.hpp"
+
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    // With the default interval, about 20 seconds of CPU time.
+    constexpr std::size_t max_samples = 20000;
+
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Profile the execution of C++ statements by sampling their call stacks");
+        argpars.add_argument("-i", "--interval")
+            .help("sample every i microseconds of CPU time")
+            .default_value(1000)
+            .scan<'i', int>();
+        argpars.add_argument("-l", "--limit")
+            .help("number of functions in the flat profile")
+            .default_value(30)
+            .scan<'i', int>();
+        argpars.add_argument("-d", "--depth")
+            .help("maximum number of frames recorded per sample")
+            .default_value(64)
+            .scan<'i', int>();
+        argpars.add_argument("--collapsed")
+            .help("write the samples to the given file, in the collapsed format of flamegraph.pl")
+            .default_value(std::string(""));
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    /***********
+     * Profile *
+     ***********/
+
+    struct flame_node
+    {
+        std::string name;
+        std::size_t count = 0;
+        std::vector<flame_node> children;
+
+        flame_node& child(const std::string& child_name)
+        {
+            auto it = std::find_if(
+                children.begin(),
+                children.end(),
+                [&child_name](const flame_node& n)
+                {
+                    return n.name == child_name;
+                }
+            );
+            if (it == children.end())
+            {
+                children.push_back({child_name, 0, {}});
+                return children.back();
+            }
+            return *it;
+        }
+    };
+
+    struct profile
+    {
+        std::size_t samples = 0;
+        std::size_t compilation_samples = 0;
+        std::map<std::string, std::size_t> self;
+        std::map<std::string, std::size_t> total;
+        // Outermost frame first.
+        std::map<std::vector<std::string>, std::size_t> stacks;
+        flame_node root;
+    };
+
+    // Samples without any JIT frame were taken while the cell was being
+    // compiled. The frames of the kernel calling the cell are dropped.
+    static profile make_profile(const std::vector<std::vector<void*>>& samples, symbolizer& symbolize)
+    {
+        profile res;
+        std::vector<const frame_symbol*> frames;
+        for (const auto& sample : samples)
+        {
+            frames.clear();
+            std::size_t outermost = sample.size();
+            for (std::size_t i = 0; i < sample.size(); ++i)
+            {
+                frames.push_back(&symbolize(sample[i], i == 0));
+                if (frames.back()->jit)
+                {
+                    outermost = i;
+                }
+            }
+            if (outermost == sample.size())
+            {
+                ++res.compilation_samples;
+                continue;
+            }
+
+            ++res.samples;
+            ++res.self[frames.front()->name];
+            std::set<std::string> seen;
+            std::vector<std::string> stack;
+            flame_node* node = &res.root;
+            ++node->count;
+            for (std::size_t i = outermost + 1; i-- > 0;)
+            {
+                const std::string& name = frames[i]->name;
+                if (seen.insert(name).second)
+                {
+                    ++res.total[name];
+                }
+                stack.push_back(name);
+                node = &node->child(name);
+                ++node->count;
+            }
+            ++res.stacks[stack];
+        }
+        return res;
+    }
+
+    /**************
+     * Formatting *
+     **************/
+
+    static std::string percent(std::size_t count, std::size_t total)
+    {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%.1f%%", total != 0 ? 100. * count / total : 0.);
+        return buf;
+    }
+
+    struct flat_entry
+    {
+        std::string name;
+        std::size_t self;
+        std::size_t total;
+    };
+
+    // Functions sorted by the samples in which they are the innermost
+    // frame, then by the samples in which they are on the stack.
+    static std::vector<flat_entry> hottest(const profile& prof, std::size_t limit)
+    {
+        std::vector<flat_entry> res;
+        for (const auto& entry : prof.total)
+        {
+            auto it = prof.self.find(entry.first);
+            res.push_back({entry.first, it != prof.self.end() ? it->second : 0, entry.second});
+        }
+        std::sort(
+            res.begin(),
+            res.end(),
+            [](const flat_entry& lhs, const flat_entry& rhs)
+            {
+                return lhs.self != rhs.self ? lhs.self > rhs.self : lhs.total > rhs.total;
+            }
+        );
+        res.resize(std::min(res.size(), limit));
+        return res;
+    }
+
+    static std::string flat_text(const profile& prof, std::size_t limit)
+    {
+        std::string res = "     self     total  function\n";
+        for (const auto& entry : hottest(prof, limit))
+        {
+            char buf[32];
+            std::snprintf(
+                buf,
+                sizeof(buf),
+                "%9s %9s  ",
+                percent(entry.self, prof.samples).c_str(),
+                percent(entry.total, prof.samples).c_str()
+            );
+            res += buf + entry.name + "\n";
+        }
+        return res;
+    }
+
+    static std::string flat_html(const profile& prof, std::size_t limit)
+    {
+        std::string res = "<table><thead><tr><th>self</th><th>total</th>"
+                          "<th style=\"text-align:left\">function</th></tr></thead><tbody>";
+        for (const auto& entry : hottest(prof, limit))
+        {
+            res += "<tr><td>" + percent(entry.self, prof.samples) + "</td><td>"
+                   + percent(entry.total, prof.samples) + "</td><td style=\"text-align:left\"><code>"
+                   + detail::html_escape(entry.name) + "</code></td></tr>";
+        }
+        return res + "</tbody></table>";
+    }
+
+    constexpr double flame_width = 1000.;
+    constexpr double flame_row = 17.;
+
+    static void render_flame(
+        const flame_node& node,
+        double x,
+        std::size_t depth,
+        double scale,
+        std::size_t total,
+        std::string& svg,
+        std::size_t& max_depth
+    )
+    {
+        double width = node.count * scale;
+        if (width < 0.5)
+        {
+            return;
+        }
+        max_depth = std::max(max_depth, depth);
+
+        // Warm colors, stable for a given function.
+        std::size_t h = std::hash<std::string>()(node.name);
+        char rect[256];
+        std::snprintf(
+            rect,
+            sizeof(rect),
+            "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" rx=\"2\" fill=\"rgb(%d,%d,%d)\"/>",
+            x,
+            depth * flame_row,
+            width,
+            flame_row - 1.,
+            205 + static_cast<int>(h % 50),
+            80 + static_cast<int>((h >> 8) % 130),
+            40 + static_cast<int>((h >> 16) % 50)
+        );
+        svg += "<g><title>" + detail::html_escape(node.name) + " (" + std::to_string(node.count)
+               + " samples, " + percent(node.count, total) + ")</title>" + rect;
+        std::size_t chars = width > 30. ? static_cast<std::size_t>((width - 6.) / 7.) : 0;
+        if (chars > 2)
+        {
+            std::string label = node.name.size() > chars ? node.name.substr(0, chars - 2) + ".." : node.name;
+            char text[64];
+            double y = depth * flame_row + 12.;
+            std::snprintf(text, sizeof(text), "<text x=\"%.1f\" y=\"%.1f\">", x + 3., y);
+            svg += text + detail::html_escape(label) + "</text>";
+        }
+        svg += "</g>";
+
+        for (const auto& child : node.children)
+        {
+            render_flame(child, x, depth + 1, scale, total, svg, max_depth);
+            x += child.count * scale;
+        }
+    }
+
+    // Callers above their callees, the width of a function being the
+    // fraction of the samples in which it is on the stack.
+    static std::string flame_svg(const profile& prof)
+    {
+        std::string body;
+        std::size_t max_depth = 0;
+        double scale = flame_width / std::max<std::size_t>(prof.samples, 1);
+        double x = 0.;
+        for (const auto& child : prof.root.children)
+        {
+            render_flame(child, x, 0, scale, prof.samples, body, max_depth);
+            x += child.count * scale;
+        }
+        char header[256];
+        std::snprintf(
+            header,
+            sizeof(header),
+            "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%.0f\" height=\"%.0f\" "
+            "style=\"font-family:monospace;font-size:11px\">",
+            flame_width,
+            (max_depth + 1) * flame_row
+        );
+        return header + body + "</svg>";
+    }
+
+    static void write_collapsed(const profile& prof, const std::string& filename)
+    {
+        std::ofstream out(filename);
+        for (const auto& entry : prof.stacks)
+        {
+            std::string line;
+            for (const auto& name : entry.first)
+            {
+                std::string frame = name;
+                std::replace(frame.begin(), frame.end(), ';', ':');
+                line += (line.empty() ? "" : ";") + frame;
+            }
+            out << line << " " << entry.second << "\n";
+        }
+        if (!out)
+        {
+            std::cerr << "Cannot write the samples to " << filename << std::endl;
+        }
+    }
+
+    /**************************
+     * Implementation of prun *
+     **************************/
+
+    prun::prun(cling::Interpreter* p)
+        : m_interpreter(p)
+        , p_symbols(std::make_shared<jit_symbols>(*p))
+    {
+    }
+
+    void prun::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("prun", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true || trim(cell).empty())
+        {
+            return;
+        }
+        long interval = std::max(argpars.get<int>("-i"), 1);
+        std::size_t limit = static_cast<std::size_t>(std::max(argpars.get<int>("-l"), 1));
+        std::size_t depth = static_cast<std::size_t>(std::max(argpars.get<int>("-d"), 4));
+        std::string collapsed = argpars.get<std::string>("--collapsed");
+
+        stack_sampler sampler(interval, max_samples, depth);
+        if (!sampler.start())
+        {
+            std::cerr << "Cannot profile the cell: " << sampler.message() << std::endl;
+            return;
+        }
+        try
+        {
+            m_interpreter->process(cell);
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+        sampler.stop();
+
+        p_symbols->update();
+        symbolizer symbolize(*p_symbols);
+        profile prof = make_profile(sampler.samples(), symbolize);
+
+        std::string summary = std::to_string(prof.samples) + " samples every " + std::to_string(interval)
+                              + " us of CPU time";
+        if (prof.compilation_samples != 0)
+        {
+            summary += ", " + std::to_string(prof.compilation_samples) + " during compilation not shown";
+        }
+        if (sampler.dropped() != 0)
+        {
+            summary += ", " + std::to_string(sampler.dropped()) + " dropped (increase the interval with -i)";
+        }
+
+        if (!collapsed.empty())
+        {
+            write_collapsed(prof, collapsed);
+        }
+        if (prof.samples == 0)
+        {
+            std::cout << summary << std::endl;
+            return;
+        }
+
+        nl::json bundle;
+        bundle["text/plain"] = summary + "\n\n" + flat_text(prof, limit);
+        bundle["text/html"] = "<div><p>" + detail::html_escape(summary) + "</p>" + flat_html(prof, limit)
+                              + flame_svg(prof) + "</div>";
+        publish_display_data(std::move(bundle), nl::json::object(), nl::json::object());
+    }
+}
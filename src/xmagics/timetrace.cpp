@@ -0,0 +1,283 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "cling/Interpreter/Exception.h"
+#include "cling/Interpreter/Interpreter.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "xcpp/xtimeit.hpp"
+
+#include "timetrace.hpp"
+#include "../xparser.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    static void get_options(argparser& argpars)
+    {
+        argpars.add_description("Profile the compilation of C++ statements with the time trace of clang");
+        argpars.add_argument("-g", "--granularity")
+            .help("minimum duration of the recorded events, in microseconds")
+            .default_value(500)
+            .scan<'i', int>();
+        argpars.add_argument("-l", "--limit")
+            .help("number of headers and of template instantiations displayed")
+            .default_value(10)
+            .scan<'i', int>();
+        argpars.add_argument("-o", "--output")
+            .help("file to which the trace is written, in the Chrome trace format")
+            .default_value(std::string("timetrace.json"));
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action([&](const std::string & /*unused*/)
+            {
+                std::cout << argpars.help().str();
+            })
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    /*****************
+     * Trace summary *
+     *****************/
+
+    // A complete event of the trace, times in microseconds.
+    struct trace_event
+    {
+        std::string detail;
+        double start;
+        double duration;
+    };
+
+    // Cost of the events with the same detail. The self time excludes the
+    // nested events of the same kind, such as the headers included by a
+    // header.
+    struct trace_cost
+    {
+        std::string detail;
+        double total = 0.;
+        double self = 0.;
+        std::size_t count = 0;
+    };
+
+    struct trace_summary
+    {
+        std::vector<trace_cost> costs;
+        // Time of the events which are not nested in another one.
+        double time = 0.;
+    };
+
+    static std::vector<trace_event> read_events(const nl::json& trace, const std::set<std::string>& names)
+    {
+        std::vector<trace_event> res;
+        auto it = trace.find("traceEvents");
+        if (it == trace.end())
+        {
+            return res;
+        }
+        for (const auto& event : *it)
+        {
+            if (event.value("ph", "") != "X" || names.count(event.value("name", "")) == 0)
+            {
+                continue;
+            }
+            std::string detail;
+            auto args = event.find("args");
+            if (args != event.end())
+            {
+                detail = args->value("detail", "");
+            }
+            // The buffers of the interpreter are the cells, not headers.
+            if (detail.compare(0, 11, "input_line_") == 0)
+            {
+                continue;
+            }
+            res.push_back({detail, event.value("ts", 0.), event.value("dur", 0.)});
+        }
+        return res;
+    }
+
+    static trace_summary summarize(std::vector<trace_event> events)
+    {
+        // Parents come before their children.
+        std::sort(
+            events.begin(),
+            events.end(),
+            [](const trace_event& lhs, const trace_event& rhs)
+            {
+                return lhs.start < rhs.start || (lhs.start == rhs.start && lhs.duration > rhs.duration);
+            }
+        );
+
+        trace_summary res;
+        std::map<std::string, trace_cost> costs;
+        std::vector<std::pair<const trace_event*, trace_cost*>> stack;
+        for (const trace_event& event : events)
+        {
+            while (!stack.empty() && stack.back().first->start + stack.back().first->duration <= event.start)
+            {
+                stack.pop_back();
+            }
+            if (stack.empty())
+            {
+                res.time += event.duration;
+            }
+            else
+            {
+                stack.back().second->self -= event.duration;
+            }
+            trace_cost& cost = costs[event.detail];
+            cost.detail = event.detail;
+            cost.total += event.duration;
+            cost.self += event.duration;
+            ++cost.count;
+            stack.emplace_back(&event, &cost);
+        }
+
+        for (auto& entry : costs)
+        {
+            res.costs.push_back(std::move(entry.second));
+        }
+        std::sort(
+            res.costs.begin(),
+            res.costs.end(),
+            [](const trace_cost& lhs, const trace_cost& rhs)
+            {
+                return lhs.total > rhs.total;
+            }
+        );
+        return res;
+    }
+
+    static std::string cost_table(const trace_summary& summary, const std::string& title, std::size_t limit)
+    {
+        std::ostringstream os;
+        os << std::setw(10) << "total" << std::setw(10) << "self" << std::setw(7) << "count" << "  " << title
+           << "\n";
+        std::size_t count = std::min(limit, summary.costs.size());
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const trace_cost& cost = summary.costs[i];
+            os << std::setw(10) << format_timespan(cost.total * 1e-6) << std::setw(10)
+               << format_timespan(cost.self * 1e-6) << std::setw(7) << cost.count << "  " << cost.detail << "\n";
+        }
+        return os.str();
+    }
+
+    /*******************************
+     * Implementation of timetrace *
+     *******************************/
+
+    timetrace::timetrace(cling::Interpreter* p)
+        : m_interpreter(p)
+    {
+    }
+
+    void timetrace::operator()(const std::string& line, const std::string& cell)
+    {
+        argparser argpars("timetrace", XEUS_CLING_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true || trim(cell).empty())
+        {
+            return;
+        }
+        unsigned granularity = static_cast<unsigned>(std::max(argpars.get<int>("-g"), 0));
+        std::size_t limit = static_cast<std::size_t>(std::max(argpars.get<int>("-l"), 1));
+        std::string filename = argpars.get<std::string>("-o");
+
+        if (llvm::timeTraceProfilerEnabled())
+        {
+            std::cerr << "The time trace profiler is already running" << std::endl;
+            return;
+        }
+
+        // The profiler records the scopes of the parser, of Sema and of the
+        // code generation of the thread running the interpreter.
+#if LLVM_VERSION_MAJOR >= 10
+        llvm::timeTraceProfilerInitialize(granularity, "xcpp");
+#else
+        llvm::timeTraceProfilerInitialize(granularity);
+#endif
+        try
+        {
+            // Includes are processed on their own, as for a regular cell.
+            for (const auto& block : split_from_includes(cell))
+            {
+                if (m_interpreter->process(block) != cling::Interpreter::kSuccess)
+                {
+                    break;
+                }
+            }
+        }
+        catch (cling::InterpreterException& e)
+        {
+            if (!e.diagnose())
+            {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+
+        llvm::SmallString<0> buffer;
+        llvm::raw_svector_ostream os(buffer);
+        llvm::timeTraceProfilerWrite(os);
+        llvm::timeTraceProfilerCleanup();
+        std::string text = buffer.str().str();
+
+        std::ofstream out(filename);
+        out << text;
+        if (!out)
+        {
+            std::cerr << "Cannot write the trace to " << filename << std::endl;
+        }
+
+        nl::json trace = nl::json::parse(text, nullptr, false);
+        if (trace.is_discarded())
+        {
+            std::cerr << "Cannot read the time trace" << std::endl;
+            return;
+        }
+        trace_summary headers = summarize(read_events(trace, {"Source"}));
+        trace_summary templates = summarize(read_events(trace, {"InstantiateClass", "InstantiateFunction"}));
+
+        std::cout << "Time trace written to " << filename << ", events of at least " << granularity
+                  << " us are recorded\n\n";
+        std::cout << "Parsing headers: " << format_timespan(headers.time * 1e-6) << " in "
+                  << headers.costs.size() << " files\n"
+                  << cost_table(headers, "header", limit) << "\n";
+        std::cout << "Instantiating templates: " << format_timespan(templates.time * 1e-6) << " in "
+                  << templates.costs.size() << " specializations\n"
+                  << cost_table(templates, "template", limit) << std::flush;
+    }
+}
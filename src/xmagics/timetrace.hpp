@@ -0,0 +1,40 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_TIMETRACE_HPP
+#define XMAGICS_TIMETRACE_HPP
+
+#include <string>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "xeus-cling/xmagics.hpp"
+#include "xeus-cling/xoptions.hpp"
+
+namespace xcpp
+{
+    /**
+     * Compiles and runs the cell under the time-trace profiler of clang,
+     * writes the trace in the Chrome trace format and displays the headers
+     * and the template instantiations which took the longest to compile.
+     */
+    class timetrace : public xmagic_cell
+    {
+    public:
+
+        timetrace(cling::Interpreter* p);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        cling::Interpreter* m_interpreter;
+    };
+}
+#endif
@@ -0,0 +1,34 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "timing.hpp"
+#include "../xphases.hpp"
+
+namespace xcpp
+{
+    /****************************
+     * Implementation of timing *
+     ****************************/
+
+    timing::timing(execute_type execute, const phase_timer& timer)
+        : m_execute(std::move(execute))
+        , p_timer(&timer)
+    {
+    }
+
+    void timing::operator()(const std::string& /*line*/, const std::string& cell)
+    {
+        m_execute(cell);
+        std::cout << p_timer->report() << std::flush;
+    }
+}
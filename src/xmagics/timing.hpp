@@ -0,0 +1,43 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#ifndef XMAGICS_TIMING_HPP
+#define XMAGICS_TIMING_HPP
+
+#include <functional>
+#include <string>
+
+#include "xeus-cling/xmagics.hpp"
+
+namespace xcpp
+{
+    class phase_timer;
+
+    /**
+     * Runs the cell as a regular cell and reports the time it spent in
+     * each phase: parsing, template instantiation, JIT compilation,
+     * execution, display of the result and publication of the output.
+     */
+    class timing : public xmagic_cell
+    {
+    public:
+
+        using execute_type = std::function<void(const std::string&)>;
+
+        timing(execute_type execute, const phase_timer& timer);
+
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        execute_type m_execute;
+        const phase_timer* p_timer;
+    };
+}
+#endif
@@ -0,0 +1,228 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+#define XCPP_HAS_MALLINFO2
+#endif
+#endif
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <malloc/malloc.h>
+#endif
+
+#include "xmemory.hpp"
+
+namespace xcpp
+{
+#if defined(__linux__)
+    // Reads the sizes of /proc/self/status, given in kB.
+    static void read_proc_status(memory_usage& usage)
+    {
+        std::FILE* file = std::fopen("/proc/self/status", "r");
+        if (file == nullptr)
+        {
+            return;
+        }
+        char line[256];
+        unsigned long long value = 0;
+        while (std::fgets(line, sizeof(line), file) != nullptr)
+        {
+            if (std::sscanf(line, "VmRSS: %llu", &value) == 1)
+            {
+                usage.rss = static_cast<std::size_t>(value) * 1024;
+                usage.has_rss = true;
+            }
+            else if (std::sscanf(line, "VmHWM: %llu", &value) == 1)
+            {
+                usage.peak_rss = static_cast<std::size_t>(value) * 1024;
+            }
+        }
+        std::fclose(file);
+    }
+#endif
+
+    memory_usage read_memory_usage()
+    {
+        memory_usage usage;
+#if defined(__linux__)
+        read_proc_status(usage);
+#elif defined(__APPLE__)
+        mach_task_basic_info_data_t info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count)
+            == KERN_SUCCESS)
+        {
+            usage.rss = static_cast<std::size_t>(info.resident_size);
+            usage.peak_rss = static_cast<std::size_t>(info.resident_size_max);
+            usage.has_rss = true;
+        }
+#endif
+
+#if defined(XCPP_HAS_MALLINFO2)
+        struct mallinfo2 info = ::mallinfo2();
+        usage.heap = info.uordblks + info.hblkhd;
+        usage.has_heap = true;
+#elif defined(__GLIBC__)
+        // The fields of mallinfo are int, and wrap around past 2 GiB.
+        struct mallinfo info = ::mallinfo();
+        usage.heap = static_cast<unsigned int>(info.uordblks) + static_cast<unsigned int>(info.hblkhd);
+        usage.has_heap = true;
+#elif defined(__APPLE__)
+        usage.heap = mstats().bytes_used;
+        usage.has_heap = true;
+#endif
+        return usage;
+    }
+
+    bool reset_peak_rss()
+    {
+#if defined(__linux__)
+        // Writing 5 to clear_refs resets VmHWM (Linux 4.0).
+        int fd = ::open("/proc/self/clear_refs", O_WRONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool res = ::write(fd, "5", 1) == 1;
+        ::close(fd);
+        return res;
+#else
+        return false;
+#endif
+    }
+
+    /*********************************
+     * Implementation of cell_memory *
+     *********************************/
+
+    nl::json cell_memory::to_json() const
+    {
+        nl::json res = nl::json::object();
+        if (has_rss)
+        {
+            res["peak_rss"] = peak_rss;
+            res["increment"] = increment;
+            res["rss_delta"] = rss_delta;
+            res["cell_peak"] = cell_peak;
+        }
+        if (has_heap)
+        {
+            res["heap_delta"] = heap_delta;
+        }
+        return res;
+    }
+
+    std::string cell_memory::report() const
+    {
+        std::string res;
+        if (has_rss)
+        {
+            res += cell_peak ? "peak memory: " : "peak memory of the process: ";
+            res += format_memory(static_cast<std::int64_t>(peak_rss)) + ", increment: " + format_memory(increment)
+                   + ", RSS delta: " + format_memory(rss_delta, true);
+        }
+        if (has_heap)
+        {
+            res += (res.empty() ? "" : ", ") + std::string("heap retained: ") + format_memory(heap_delta, true);
+        }
+        return res.empty() ? "memory usage is not available on this platform" : res;
+    }
+
+    /************************************
+     * Implementation of memory_tracker *
+     ************************************/
+
+    // Innermost running tracker, the trackers run on the thread of the
+    // interpreter.
+    static memory_tracker* innermost_tracker = nullptr;
+
+    memory_tracker::~memory_tracker()
+    {
+        release();
+    }
+
+    void memory_tracker::start()
+    {
+        release();
+        // Resetting the peak loses the one of the enclosing trackers, such
+        // as the one of %memit --always around a %%memit cell.
+        if (innermost_tracker != nullptr)
+        {
+            std::size_t peak = read_memory_usage().peak_rss;
+            for (memory_tracker* outer = innermost_tracker; outer != nullptr; outer = outer->p_outer)
+            {
+                outer->m_nested_peak = std::max(outer->m_nested_peak, peak);
+            }
+        }
+        p_outer = innermost_tracker;
+        innermost_tracker = this;
+        m_running = true;
+        m_nested_peak = 0;
+        m_cell_peak = reset_peak_rss();
+        m_before = read_memory_usage();
+    }
+
+    cell_memory memory_tracker::stop()
+    {
+        memory_usage after = read_memory_usage();
+        release();
+        cell_memory res;
+        res.has_rss = after.has_rss;
+        res.has_heap = after.has_heap;
+        res.cell_peak = m_cell_peak;
+        // The peak is sampled by the kernel, it can lag behind the current
+        // resident set size.
+        res.peak_rss = std::max({after.peak_rss, after.rss, m_nested_peak});
+        res.increment = static_cast<std::int64_t>(res.peak_rss) - static_cast<std::int64_t>(m_before.rss);
+        res.rss_delta = static_cast<std::int64_t>(after.rss) - static_cast<std::int64_t>(m_before.rss);
+        res.heap_delta = static_cast<std::int64_t>(after.heap) - static_cast<std::int64_t>(m_before.heap);
+        return res;
+    }
+
+    void memory_tracker::release()
+    {
+        if (!m_running)
+        {
+            return;
+        }
+        memory_tracker** link = &innermost_tracker;
+        while (*link != nullptr && *link != this)
+        {
+            link = &(*link)->p_outer;
+        }
+        if (*link == this)
+        {
+            *link = p_outer;
+        }
+        p_outer = nullptr;
+        m_running = false;
+    }
+
+    std::string format_memory(std::int64_t bytes, bool signed_size)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), signed_size ? "%+.2f MiB" : "%.2f MiB", bytes / 1048576.);
+        return buf;
+    }
+}
@@ -0,0 +1,96 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_MEMORY_HPP
+#define XCPP_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    // Memory used by the process, in bytes. Sizes which cannot be read on
+    // this platform are left to zero.
+    struct memory_usage
+    {
+        // Resident set size, and its peak since the start of the process
+        // or since the last call to reset_peak_rss.
+        std::size_t rss = 0;
+        std::size_t peak_rss = 0;
+        // Bytes allocated by malloc and not freed.
+        std::size_t heap = 0;
+        bool has_rss = false;
+        bool has_heap = false;
+    };
+
+    memory_usage read_memory_usage();
+
+    // Sets the peak resident set size to the current one. Returns false if
+    // the platform does not allow it.
+    bool reset_peak_rss();
+
+    // Memory used by a cell, in bytes.
+    struct cell_memory
+    {
+        std::size_t peak_rss = 0;
+        // Peak minus the resident set size before the cell.
+        std::int64_t increment = 0;
+        std::int64_t rss_delta = 0;
+        // Heap still allocated after the cell.
+        std::int64_t heap_delta = 0;
+        // Whether peak_rss is the peak of the cell or of the process.
+        bool cell_peak = false;
+        bool has_rss = false;
+        bool has_heap = false;
+
+        nl::json to_json() const;
+        std::string report() const;
+    };
+
+    /**
+     * Measures the memory used between start and stop. The peak of the
+     * resident set size is the one of the cell on Linux, where it can be
+     * reset, and the one of the process elsewhere. Trackers can be nested,
+     * the peak of the enclosing ones is kept when an inner one resets it.
+     */
+    class memory_tracker
+    {
+    public:
+
+        memory_tracker() = default;
+        ~memory_tracker();
+
+        memory_tracker(const memory_tracker&) = delete;
+        memory_tracker& operator=(const memory_tracker&) = delete;
+
+        void start();
+        cell_memory stop();
+
+    private:
+
+        void release();
+
+        memory_usage m_before;
+        // Peak before it was reset by a nested tracker.
+        std::size_t m_nested_peak = 0;
+        memory_tracker* p_outer = nullptr;
+        bool m_cell_peak = false;
+        bool m_running = false;
+    };
+
+    // Size in MiB, with a sign if signed_size is true.
+    std::string format_memory(std::int64_t bytes, bool signed_size = false);
+}
+
+#endif
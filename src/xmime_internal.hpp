@@ -11,12 +11,19 @@
 #define XCPP_MIME_INTERNAL_HPP
 
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <locale>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/Decl.h>
 #include <clang/AST/DeclCXX.h>
+#include <clang/AST/DeclFriend.h>
+#include <clang/AST/DeclTemplate.h>
 #include <clang/AST/Expr.h>
 #include <clang/AST/Type.h>
 #include <clang/Frontend/CompilerInstance.h>
@@ -38,6 +45,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "xcpp/xmime.hpp"
+
 namespace nl = nlohmann;
 
 namespace xcpp
@@ -175,10 +184,471 @@ namespace xcpp
         }
     }
 
+    /*********************
+     * native mime reprs *
+     *********************/
+
+    namespace native_detail
+    {
+        template <class T>
+        struct type_tag
+        {
+            using type = T;
+        };
+
+        // Calls f with the type_tag of the builtin type, returns false if it
+        // is not supported.
+        template <class F>
+        bool visit_builtin(const clang::QualType& Ty, F&& f)
+        {
+            auto BT = llvm::dyn_cast<clang::BuiltinType>(Ty.getCanonicalType());
+            if (BT == nullptr)
+            {
+                return false;
+            }
+            switch (BT->getKind())
+            {
+                case clang::BuiltinType::Bool:
+                    f(type_tag<bool>());
+                    return true;
+                case clang::BuiltinType::Char_S:
+                case clang::BuiltinType::Char_U:
+                    f(type_tag<char>());
+                    return true;
+                case clang::BuiltinType::SChar:
+                    f(type_tag<signed char>());
+                    return true;
+                case clang::BuiltinType::UChar:
+                    f(type_tag<unsigned char>());
+                    return true;
+                case clang::BuiltinType::WChar_S:
+                case clang::BuiltinType::WChar_U:
+                    f(type_tag<wchar_t>());
+                    return true;
+                case clang::BuiltinType::Char16:
+                    f(type_tag<char16_t>());
+                    return true;
+                case clang::BuiltinType::Char32:
+                    f(type_tag<char32_t>());
+                    return true;
+                case clang::BuiltinType::Short:
+                    f(type_tag<short>());
+                    return true;
+                case clang::BuiltinType::UShort:
+                    f(type_tag<unsigned short>());
+                    return true;
+                case clang::BuiltinType::Int:
+                    f(type_tag<int>());
+                    return true;
+                case clang::BuiltinType::UInt:
+                    f(type_tag<unsigned int>());
+                    return true;
+                case clang::BuiltinType::Long:
+                    f(type_tag<long>());
+                    return true;
+                case clang::BuiltinType::ULong:
+                    f(type_tag<unsigned long>());
+                    return true;
+                case clang::BuiltinType::LongLong:
+                    f(type_tag<long long>());
+                    return true;
+                case clang::BuiltinType::ULongLong:
+                    f(type_tag<unsigned long long>());
+                    return true;
+                case clang::BuiltinType::Float:
+                    f(type_tag<float>());
+                    return true;
+                case clang::BuiltinType::Double:
+                    f(type_tag<double>());
+                    return true;
+                case clang::BuiltinType::LongDouble:
+                    f(type_tag<long double>());
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Template arguments of Ty if it is a specialization of the given
+        // class template of the standard library.
+        inline const clang::TemplateArgumentList* std_template_args(const clang::QualType& Ty, const char* name)
+        {
+            auto SD = llvm::dyn_cast_or_null<clang::ClassTemplateSpecializationDecl>(
+                Ty.getCanonicalType()->getAsCXXRecordDecl()
+            );
+            if (SD == nullptr || !SD->isInStdNamespace() || SD->getName() != name)
+            {
+                return nullptr;
+            }
+            return &SD->getTemplateArgs();
+        }
+
+        inline bool is_std_template_of(const clang::TemplateArgument& arg, const char* name, const clang::QualType& Ty)
+        {
+            if (arg.getKind() != clang::TemplateArgument::Type)
+            {
+                return false;
+            }
+            auto args = std_template_args(arg.getAsType(), name);
+            return args != nullptr && args->size() != 0 && args->get(0).getKind() == clang::TemplateArgument::Type
+                   && args->get(0).getAsType().getCanonicalType() == Ty.getCanonicalType();
+        }
+
+        inline bool is_std_string(const clang::QualType& Ty)
+        {
+            auto args = std_template_args(Ty, "basic_string");
+            if (args == nullptr || args->size() != 3 || args->get(0).getKind() != clang::TemplateArgument::Type)
+            {
+                return false;
+            }
+            clang::QualType CharTy = args->get(0).getAsType().getCanonicalType();
+            return (CharTy->isSpecificBuiltinType(clang::BuiltinType::Char_S)
+                    || CharTy->isSpecificBuiltinType(clang::BuiltinType::Char_U))
+                   && is_std_template_of(args->get(1), "char_traits", CharTy)
+                   && is_std_template_of(args->get(2), "allocator", CharTy);
+        }
+
+        // Element type of Ty if it is a std::vector with the default
+        // allocator.
+        inline bool get_std_vector_element(const clang::QualType& Ty, clang::QualType& element)
+        {
+            auto args = std_template_args(Ty, "vector");
+            if (args == nullptr || args->size() != 2 || args->get(0).getKind() != clang::TemplateArgument::Type)
+            {
+                return false;
+            }
+            element = args->get(0).getAsType();
+            return is_std_template_of(args->get(1), "allocator", element);
+        }
+    }
+
+    /**
+     * Builds the mime bundle of builtin values, pointers, std::string and
+     * std::vector of those in kernel code, with the same mime_bundle_repr
+     * overloads as the ones the notebook would use. Returns false for other
+     * types, which need the JIT-compiled overloads.
+     *
+     * The kernel and the notebook share the standard library, so that the
+     * values of the standard types can be read in place.
+     */
+    inline bool native_mime_repr(const cling::Value& V, nl::json& res)
+    {
+        using xcpp::mime_bundle_repr;
+
+        clang::QualType Ty = V.getType();
+        if (Ty->isReferenceType())
+        {
+            return false;
+        }
+        Ty = Ty.getCanonicalType();
+
+        bool is_builtin = native_detail::visit_builtin(
+            Ty,
+            [&V, &res](auto tag)
+            {
+                using value_type = typename decltype(tag)::type;
+                res = mime_bundle_repr(V.simplisticCastAs<value_type>());
+            }
+        );
+        if (is_builtin)
+        {
+            return true;
+        }
+
+        if (Ty->isPointerType())
+        {
+            clang::QualType PointeeTy = Ty->getPointeeType();
+            if (PointeeTy->isSpecificBuiltinType(clang::BuiltinType::Char_S)
+                || PointeeTy->isSpecificBuiltinType(clang::BuiltinType::Char_U))
+            {
+                if (PointeeTy.isConstQualified())
+                {
+                    res = mime_bundle_repr(static_cast<const char*>(V.getPtr()));
+                }
+                else
+                {
+                    res = mime_bundle_repr(static_cast<char*>(V.getPtr()));
+                }
+                return true;
+            }
+            if (PointeeTy->isCharType())
+            {
+                return false;
+            }
+            // As getTypeString, print the address of other pointers.
+            const void* ptr = V.getPtr();
+            res = mime_bundle_repr(ptr);
+            return true;
+        }
+
+        const void* ptr = V.getPtr();
+        if (ptr == nullptr)
+        {
+            return false;
+        }
+
+        if (native_detail::is_std_string(Ty))
+        {
+            res = mime_bundle_repr(*static_cast<const std::string*>(ptr));
+            return true;
+        }
+
+        clang::QualType ElementTy;
+        if (native_detail::get_std_vector_element(Ty, ElementTy))
+        {
+            if (native_detail::is_std_string(ElementTy))
+            {
+                res = mime_bundle_repr(*static_cast<const std::vector<std::string>*>(ptr));
+                return true;
+            }
+            return native_detail::visit_builtin(
+                ElementTy,
+                [ptr, &res](auto tag)
+                {
+                    using value_type = typename decltype(tag)::type;
+                    res = mime_bundle_repr(*static_cast<const std::vector<value_type>*>(ptr));
+                }
+            );
+        }
+        return false;
+    }
+
+    /******************
+     * display thunks *
+     ******************/
+
+    // JIT-compiled function computing the mime bundle of a value. The first
+    // argument is the address of the storage of the cling::Value, the
+    // second one the nl::json receiving the bundle.
+    using mime_thunk_type = void (*)(const void*, void*);
+
+    /**
+     * Display thunks compiled so far, keyed by the canonical type of the
+     * displayed values, so that displaying a value of a known type costs a
+     * function call instead of a compilation and a new transaction.
+     */
+    class xmime_cache
+    {
+    public:
+
+        xmime_cache();
+
+        bool enabled() const;
+        std::size_t size() const;
+
+        // Returns nullptr if no thunk can be compiled for the type of V.
+        // reported is set to true if the compilation was attempted by this
+        // call and failed, its diagnostics have then been printed.
+        mime_thunk_type get(const cling::Value& V, bool& reported);
+
+        // Must be called when new mime_bundle_repr or printValue overloads
+        // are declared, since they may be better matches than the ones of
+        // the thunks, and when a transaction is unloaded, since the types of
+        // the keys and the thunks may have been unloaded with it.
+        void clear();
+
+    private:
+
+        mime_thunk_type compile(const cling::Value& V);
+
+        std::unordered_map<void*, mime_thunk_type> m_thunks;
+        std::size_t m_counter;
+        bool m_enabled;
+    };
+
+    inline xmime_cache& get_mime_cache()
+    {
+        static xmime_cache cache;
+        return cache;
+    }
+
+    // Whether decl declares a mime_bundle_repr or a printValue function,
+    // in a namespace or as a friend of a class.
+    inline bool declares_display_overload(const clang::Decl* decl)
+    {
+        if (const auto* function_template = llvm::dyn_cast<clang::FunctionTemplateDecl>(decl))
+        {
+            decl = function_template->getTemplatedDecl();
+        }
+        else if (const auto* class_template = llvm::dyn_cast<clang::ClassTemplateDecl>(decl))
+        {
+            decl = class_template->getTemplatedDecl();
+        }
+
+        if (const auto* function = llvm::dyn_cast<clang::FunctionDecl>(decl))
+        {
+            const clang::IdentifierInfo* name = function->getIdentifier();
+            return name != nullptr && (name->getName() == "mime_bundle_repr" || name->getName() == "printValue");
+        }
+        if (llvm::isa<clang::NamespaceDecl>(decl) || llvm::isa<clang::LinkageSpecDecl>(decl))
+        {
+            for (const clang::Decl* child : llvm::cast<clang::DeclContext>(decl)->decls())
+            {
+                if (declares_display_overload(child))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+        const auto* record = llvm::dyn_cast<clang::CXXRecordDecl>(decl);
+        if (record != nullptr && record->isThisDeclarationADefinition())
+        {
+            for (const clang::FriendDecl* friend_decl : record->friends())
+            {
+                const clang::NamedDecl* named = friend_decl->getFriendDecl();
+                if (named != nullptr && declares_display_overload(named))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    inline bool declares_display_overload(const cling::Transaction& transaction)
+    {
+        for (auto it = transaction.decls_begin(); it != transaction.decls_end(); ++it)
+        {
+            // Instantiations, such as the ones of the thunks, do not add
+            // overloads.
+            if (it->m_Call == cling::Transaction::kCCIHandleCXXImplicitFunctionInstantiation
+                || it->m_Call == cling::Transaction::kCCIHandleCXXStaticMemberVarInstantiation)
+            {
+                continue;
+            }
+            for (const clang::Decl* decl : it->m_DGR)
+            {
+                if (decl != nullptr && declares_display_overload(decl))
+                {
+                    return true;
+                }
+            }
+        }
+        if (transaction.hasNestedTransactions())
+        {
+            for (auto it = transaction.nested_begin(); it != transaction.nested_end(); ++it)
+            {
+                if (declares_display_overload(**it))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Clears the cache of display thunks when a transaction declares new
+    // mime_bundle_repr or printValue overloads, which may be better matches
+    // than the ones of the thunks, and when a transaction is unloaded, with
+    // .undo or when a cell fails.
+    class xmime_cache_callbacks : public cling::InterpreterCallbacks
+    {
+    public:
+
+        explicit xmime_cache_callbacks(cling::Interpreter* interpreter)
+            : cling::InterpreterCallbacks(interpreter)
+        {
+        }
+
+        void TransactionCommitted(const cling::Transaction& transaction) override
+        {
+            if (get_mime_cache().size() != 0 && declares_display_overload(transaction))
+            {
+                get_mime_cache().clear();
+            }
+        }
+
+        void TransactionUnloaded(const cling::Transaction&) override
+        {
+            get_mime_cache().clear();
+        }
+    };
+
+    inline void install_mime_cache_callbacks(cling::Interpreter& interpreter)
+    {
+        interpreter.setCallbacks(std::make_unique<xmime_cache_callbacks>(&interpreter));
+    }
+
+    inline xmime_cache::xmime_cache()
+        : m_thunks()
+        , m_counter(0)
+        , m_enabled(true)
+    {
+        // Allows comparing with the uncached display.
+        const char* env = std::getenv("XEUS_CLING_DISPLAY_CACHE");
+        m_enabled = env == nullptr || std::strcmp(env, "0") != 0;
+    }
+
+    inline bool xmime_cache::enabled() const
+    {
+        return m_enabled;
+    }
+
+    inline std::size_t xmime_cache::size() const
+    {
+        return m_thunks.size();
+    }
+
+    inline mime_thunk_type xmime_cache::get(const cling::Value& V, bool& reported)
+    {
+        reported = false;
+        clang::QualType key = V.getType().getNonReferenceType().getCanonicalType();
+        auto it = m_thunks.find(key.getAsOpaquePtr());
+        if (it == m_thunks.end())
+        {
+            // Failures are cached as well, mime_repr falls back to the
+            // uncached path for the next values of the type. The failed
+            // transaction may clear the cache, the thunk is compiled before
+            // it is inserted.
+            mime_thunk_type thunk = compile(V);
+            reported = thunk == nullptr;
+            it = m_thunks.emplace(key.getAsOpaquePtr(), thunk).first;
+        }
+        return it->second;
+    }
+
+    inline void xmime_cache::clear()
+    {
+        m_thunks.clear();
+    }
+
+    inline mime_thunk_type xmime_cache::compile(const cling::Value& V)
+    {
+        cling::Interpreter* interpreter = V.getInterpreter();
+        std::string name = "__xcpp_mime_thunk_" + std::to_string(++m_counter);
+
+        // Same expression as the uncached path of mime_repr, applied to the
+        // argument instead of an address literal.
+        std::string code = "extern \"C\" void " + name + "(const void* value, void* res)\n{\n";
+        code += "    using xcpp::mime_bundle_repr;\n";
+        code += "    *static_cast<nlohmann::json*>(res) = mime_bundle_repr(*(";
+        code += cling_detail::getTypeString(V);
+        code += "value));\n}\n";
+
+        cling_detail::AccessCtrlRAII_t AccessCtrlRAII(*interpreter);
+        cling_detail::LockCompilationDuringUserCodeExecutionRAII LCDUCER(*interpreter);
+        if (interpreter->declare(code) != cling::Interpreter::kSuccess)
+        {
+            return nullptr;
+        }
+        return reinterpret_cast<mime_thunk_type>(interpreter->getAddressOfGlobal(name));
+    }
+
+    /*************
+     * mime_repr *
+     *************/
+
     inline nl::json mime_repr(const cling::Value& V)
     {
         // Return a JSON mime bundle representing the specified value.
 
+        nl::json bundle;
+        if (native_mime_repr(V, bundle))
+        {
+            return bundle;
+        }
+
         cling::Interpreter* interpreter = V.getInterpreter();
         const void* value = V.getPtr();
 
@@ -192,6 +662,24 @@ namespace xcpp
             xmime_included = true;
         }
 
+        xmime_cache& cache = get_mime_cache();
+        if (cache.enabled())
+        {
+            bool reported = false;
+            if (mime_thunk_type thunk = cache.get(V, reported))
+            {
+                nl::json res = nl::json::object();
+                cling_detail::LockCompilationDuringUserCodeExecutionRAII LCDUCER(*interpreter);
+                thunk(&value, &res);
+                return res;
+            }
+            // The uncached path would fail with the same diagnostics.
+            if (reported)
+            {
+                return nl::json::object();
+            }
+        }
+
         cling::Value mimeReprV;
         {
             // Use an llvm::raw_ostream to prepend '0x' in front of the pointer value.
@@ -0,0 +1,112 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "cling/Interpreter/Interpreter.h"
+
+#include "clang/Basic/CodeGenOptions.h"
+#include "clang/Basic/LangOptions.h"
+#include "clang/Basic/TargetOptions.h"
+#include "clang/Frontend/CompilerInstance.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+
+#include "xoptimization.hpp"
+
+namespace xcpp
+{
+    /*******************************************
+     * Implementation of optimization_settings *
+     *******************************************/
+
+    nl::json optimization_settings::to_json() const
+    {
+        nl::json res;
+        res["level"] = level;
+        res["native"] = native;
+        res["fast_math"] = fast_math;
+        return res;
+    }
+
+    optimization_settings current_optimization(cling::Interpreter& interpreter)
+    {
+        const clang::CompilerInstance& ci = *interpreter.getCI();
+        optimization_settings res;
+        // A negative level stands for the one of the code generation options.
+        res.level = interpreter.getDefaultOptLevel();
+        if (res.level < 0)
+        {
+            res.level = static_cast<int>(ci.getCodeGenOpts().OptimizationLevel);
+        }
+        res.native = ci.getTargetOpts().CPU == llvm::sys::getHostCPUName();
+        res.fast_math = ci.getLangOpts().FastMath;
+        return res;
+    }
+
+    /****************************************
+     * Implementation of optimization_scope *
+     ****************************************/
+
+    optimization_scope::optimization_scope(
+        cling::Interpreter& interpreter,
+        const optimization_settings& settings
+    )
+        : m_interpreter(interpreter)
+        , m_level(interpreter.getDefaultOptLevel())
+        , m_cpu(interpreter.getCI()->getTargetOpts().CPU)
+        , m_features(interpreter.getCI()->getTargetOpts().Features)
+        , m_fast_math(interpreter.getCI()->getLangOpts().FastMath)
+        , m_finite_math(interpreter.getCI()->getLangOpts().FiniteMathOnly)
+    {
+        // The code generator of cling keeps a copy of the CodeGenOptions,
+        // the level is set on the compilation options of the transactions,
+        // as by "#pragma cling optimize".
+        m_interpreter.setDefaultOptLevel(settings.level);
+
+        // The target options are shared with the TargetInfo, from which
+        // the target-cpu and target-features attributes of the functions
+        // are set.
+        clang::TargetOptions& target_opts = m_interpreter.getCI()->getTargetOpts();
+        llvm::StringMap<bool> host_features;
+        if (settings.native && llvm::sys::getHostCPUFeatures(host_features))
+        {
+            target_opts.CPU = llvm::sys::getHostCPUName();
+            target_opts.Features.clear();
+            for (const auto& feature : host_features)
+            {
+                target_opts.Features.push_back((feature.getValue() ? "+" : "-") + feature.getKey().str());
+            }
+            std::sort(target_opts.Features.begin(), target_opts.Features.end());
+        }
+
+        // Read by the code generation of each function to set the
+        // fast-math flags of its floating-point operations.
+        if (settings.fast_math)
+        {
+            clang::LangOptions& lang_opts = m_interpreter.getCI()->getLangOpts();
+            lang_opts.FastMath = 1;
+            lang_opts.FiniteMathOnly = 1;
+        }
+    }
+
+    optimization_scope::~optimization_scope()
+    {
+        m_interpreter.setDefaultOptLevel(m_level);
+        clang::TargetOptions& target_opts = m_interpreter.getCI()->getTargetOpts();
+        target_opts.CPU = m_cpu;
+        target_opts.Features = m_features;
+        clang::LangOptions& lang_opts = m_interpreter.getCI()->getLangOpts();
+        lang_opts.FastMath = m_fast_math;
+        lang_opts.FiniteMathOnly = m_finite_math;
+    }
+}
@@ -0,0 +1,73 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_OPTIMIZATION_HPP
+#define XCPP_OPTIMIZATION_HPP
+
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace cling
+{
+    class Interpreter;
+}
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    // Code generation settings of the transactions of the interpreter.
+    struct optimization_settings
+    {
+        int level = 0;
+        // Code generated for the features of the host CPU.
+        bool native = false;
+        bool fast_math = false;
+
+        // {"level": 2, "native": false, "fast_math": false}
+        nl::json to_json() const;
+    };
+
+    // Settings of the next transaction. The level defaults to the -O<n>
+    // flag of the command line of the kernel, -O0 if there is none.
+    optimization_settings current_optimization(cling::Interpreter& interpreter);
+
+    /**
+     * Applies optimization settings to the transactions compiled during
+     * its lifetime, and restores the previous ones on destruction. The
+     * level is the one of the optimization passes that cling runs on each
+     * transaction; the target features and the fast-math mode are those
+     * which clang reads when it generates the code of a function. The
+     * predefined macros, such as __AVX2__ and __FAST_MATH__, are not
+     * changed.
+     */
+    class optimization_scope
+    {
+    public:
+
+        optimization_scope(cling::Interpreter& interpreter, const optimization_settings& settings);
+        ~optimization_scope();
+
+        optimization_scope(const optimization_scope&) = delete;
+        optimization_scope& operator=(const optimization_scope&) = delete;
+
+    private:
+
+        cling::Interpreter& m_interpreter;
+        int m_level;
+        std::string m_cpu;
+        std::vector<std::string> m_features;
+        bool m_fast_math;
+        bool m_finite_math;
+    };
+}
+
+#endif
@@ -0,0 +1,291 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "xperf_events.hpp"
+
+namespace xcpp
+{
+#ifdef __linux__
+    struct event_spec
+    {
+        const char* name;
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    // Read misses of the given cache.
+    constexpr std::uint64_t cache_misses(std::uint64_t cache)
+    {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    // Events that must be read together are in the same group, small
+    // enough to fit in the counters of any PMU.
+    static const std::vector<std::vector<event_spec>>& hardware_groups()
+    {
+        static const std::vector<std::vector<event_spec>> groups = {
+            {{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+             {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}},
+            {{"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+             {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}},
+            {{"L1-dcache-load-misses", PERF_TYPE_HW_CACHE, cache_misses(PERF_COUNT_HW_CACHE_L1D)},
+             {"LLC-load-misses", PERF_TYPE_HW_CACHE, cache_misses(PERF_COUNT_HW_CACHE_LL)}}
+        };
+        return groups;
+    }
+
+    static const std::vector<event_spec>& software_group()
+    {
+        static const std::vector<event_spec> group = {
+            {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+            {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {"cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS}
+        };
+        return group;
+    }
+
+    static int open_event(const event_spec& spec, int group_fd, bool exclude_kernel)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = spec.type;
+        attr.config = spec.config;
+        // Members follow the leader, which is enabled explicitly.
+        attr.disabled = group_fd == -1 ? 1 : 0;
+        attr.exclude_kernel = exclude_kernel ? 1 : 0;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.read_format |= PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        long fd = ::syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+        return static_cast<int>(fd);
+    }
+
+    static std::string paranoid_level()
+    {
+        std::ifstream in("/proc/sys/kernel/perf_event_paranoid");
+        std::string level;
+        in >> level;
+        return level.empty() ? "unknown" : level;
+    }
+#endif
+
+#ifndef _WIN32
+    // Thread CPU time in nanoseconds, page faults and context switches.
+    static void rusage_sample(double* res)
+    {
+        rusage usage;
+#ifdef RUSAGE_THREAD
+        ::getrusage(RUSAGE_THREAD, &usage);
+#else
+        ::getrusage(RUSAGE_SELF, &usage);
+#endif
+        res[0] = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e9
+                 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e3;
+        res[1] = static_cast<double>(usage.ru_minflt + usage.ru_majflt);
+        res[2] = static_cast<double>(usage.ru_nvcsw + usage.ru_nivcsw);
+    }
+#endif
+
+    perf_counters::perf_counters()
+        : m_groups()
+        , m_hardware(false)
+        , m_message()
+        , m_rusage(false)
+        , m_rusage_counts{0., 0., 0.}
+        , m_rusage_start{0., 0., 0.}
+    {
+#ifdef __linux__
+        // perf_event_paranoid 2 only allows user space counting.
+        bool exclude_kernel = false;
+        int hardware_errno = 0;
+        std::string unsupported;
+        auto add_unsupported = [&unsupported](const char* name)
+        {
+            unsupported += unsupported.empty() ? name : std::string(", ") + name;
+        };
+
+        auto open_group = [&](const std::vector<event_spec>& specs) -> int
+        {
+            group g;
+            for (const auto& spec : specs)
+            {
+                int leader = g.fds.empty() ? -1 : g.fds.front();
+                int fd = open_event(spec, leader, exclude_kernel);
+                if (fd < 0 && (errno == EACCES || errno == EPERM) && !exclude_kernel)
+                {
+                    exclude_kernel = true;
+                    fd = open_event(spec, leader, exclude_kernel);
+                }
+                if (fd < 0)
+                {
+                    if (leader == -1)
+                    {
+                        return errno;
+                    }
+                    add_unsupported(spec.name);
+                    continue;
+                }
+                g.fds.push_back(fd);
+                g.names.push_back(spec.name);
+            }
+            ::ioctl(g.fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            m_groups.push_back(std::move(g));
+            return 0;
+        };
+
+        for (const auto& specs : hardware_groups())
+        {
+            if (int err = open_group(specs))
+            {
+                hardware_errno = err;
+                add_unsupported(specs.front().name);
+            }
+            else
+            {
+                m_hardware = true;
+            }
+        }
+        int software_errno = open_group(software_group());
+
+        if (!m_hardware)
+        {
+            m_message = "hardware counters are not available (" + std::string(std::strerror(hardware_errno))
+                        + ", perf_event_paranoid is " + paranoid_level() + ")";
+        }
+        else if (!unsupported.empty())
+        {
+            m_message = "not supported: " + unsupported;
+        }
+        if (software_errno != 0)
+        {
+            m_rusage = true;
+            m_message += std::string(m_message.empty() ? "" : "; ") + "software events are not available ("
+                         + std::strerror(software_errno) + "), using getrusage";
+        }
+#elif !defined(_WIN32)
+        m_rusage = true;
+        m_message = "hardware counters are only supported on Linux, using getrusage";
+#else
+        m_message = "counters are not supported on Windows";
+#endif
+    }
+
+    perf_counters::~perf_counters()
+    {
+#ifndef _WIN32
+        for (const auto& g : m_groups)
+        {
+            for (int fd : g.fds)
+            {
+                ::close(fd);
+            }
+        }
+#endif
+    }
+
+    void perf_counters::start()
+    {
+#ifdef __linux__
+        for (const auto& g : m_groups)
+        {
+            ::ioctl(g.fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+#ifndef _WIN32
+        if (m_rusage)
+        {
+            rusage_sample(m_rusage_start);
+        }
+#endif
+    }
+
+    void perf_counters::stop()
+    {
+#ifndef _WIN32
+        if (m_rusage)
+        {
+            double end[3];
+            rusage_sample(end);
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                m_rusage_counts[i] += end[i] - m_rusage_start[i];
+            }
+        }
+#endif
+#ifdef __linux__
+        for (const auto& g : m_groups)
+        {
+            ::ioctl(g.fds.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    std::vector<perf_count> perf_counters::read() const
+    {
+        std::vector<perf_count> res;
+#ifdef __linux__
+        for (const auto& g : m_groups)
+        {
+            // nr, time_enabled, time_running, then one value per event.
+            std::vector<std::uint64_t> buf(3 + g.fds.size(), 0);
+            ssize_t size = ::read(g.fds.front(), buf.data(), buf.size() * sizeof(std::uint64_t));
+            if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t)))
+            {
+                continue;
+            }
+            double enabled = static_cast<double>(buf[1]);
+            double running = static_cast<double>(buf[2]);
+            for (std::size_t i = 0; i < g.names.size() && i < buf[0]; ++i)
+            {
+                double value = running > 0. ? buf[3 + i] * (enabled / running) : 0.;
+                res.push_back({g.names[i], value, enabled > 0. ? running / enabled : 0.});
+            }
+        }
+#endif
+        if (m_rusage)
+        {
+            res.push_back({"task-clock", m_rusage_counts[0], 1.});
+            res.push_back({"page-faults", m_rusage_counts[1], 1.});
+            res.push_back({"context-switches", m_rusage_counts[2], 1.});
+        }
+        return res;
+    }
+
+    bool perf_counters::has_hardware_counters() const
+    {
+        return m_hardware;
+    }
+
+    const std::string& perf_counters::message() const
+    {
+        return m_message;
+    }
+}
@@ -0,0 +1,77 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_PERF_EVENTS_HPP
+#define XCPP_PERF_EVENTS_HPP
+
+#include <string>
+#include <vector>
+
+namespace xcpp
+{
+    struct perf_count
+    {
+        std::string name;
+        double value;
+        // Fraction of the measurement during which the event was counted,
+        // less than 1 when the kernel multiplexed the counters. The value
+        // is scaled accordingly, and is meaningless if running is 0.
+        double running;
+    };
+
+    /**
+     * Counters of the calling thread, opened with perf_event_open in groups
+     * that are scheduled together: cycles and instructions, branches and
+     * branch misses, L1 data and last level cache misses, and software
+     * events. When perf_event_paranoid or the machine (e.g. a virtual one)
+     * forbids the hardware counters, only the software events are counted,
+     * and when perf_event_open is not available at all, the thread CPU
+     * time, page faults and context switches are read from getrusage.
+     */
+    class perf_counters
+    {
+    public:
+
+        perf_counters();
+        ~perf_counters();
+
+        perf_counters(const perf_counters&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+
+        // Counts are accumulated over several start/stop periods.
+        void start();
+        void stop();
+        std::vector<perf_count> read() const;
+
+        bool has_hardware_counters() const;
+
+        // Why some counters are not available, empty if they all are.
+        const std::string& message() const;
+
+    private:
+
+        struct group
+        {
+            // The first file descriptor is the leader of the group.
+            std::vector<int> fds;
+            std::vector<std::string> names;
+        };
+
+        std::vector<group> m_groups;
+        bool m_hardware;
+        std::string m_message;
+
+        // Fallback when there is no perf_event_open.
+        bool m_rusage;
+        double m_rusage_counts[3];
+        double m_rusage_start[3];
+    };
+}
+
+#endif
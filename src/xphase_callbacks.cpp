@@ -0,0 +1,141 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "cling/Interpreter/Interpreter.h"
+#include "cling/Interpreter/InterpreterCallbacks.h"
+
+#include "clang/Sema/Sema.h"
+#include "clang/Sema/TemplateInstCallback.h"
+
+#include "xphase_callbacks.hpp"
+
+namespace xcpp
+{
+    /********************************
+     * Callbacks of the interpreter *
+     ********************************/
+
+    namespace
+    {
+        class phase_callbacks : public cling::InterpreterCallbacks
+        {
+        public:
+
+            phase_callbacks(cling::Interpreter* interpreter, phase_timer& timer)
+                : cling::InterpreterCallbacks(interpreter)
+                , m_timer(timer)
+            {
+            }
+
+            // The transaction is parsed and its module is given to the JIT,
+            // which compiles it when its symbols are first looked up.
+            void TransactionCommitted(const cling::Transaction&) override
+            {
+                if (m_timer.current() == cell_phase::parse)
+                {
+                    m_timer.enter(cell_phase::jit);
+                }
+            }
+
+            // cling nests these calls when user code invokes the interpreter.
+            // The phases to return to are kept here since the state returned
+            // to cling may be shared with its other callbacks.
+            void* EnteringUserCode() override
+            {
+                cell_phase previous = m_timer.current();
+                m_entered.push_back(previous);
+                if (previous != cell_phase::none)
+                {
+                    m_timer.enter(cell_phase::execution);
+                }
+                return nullptr;
+            }
+
+            void ReturnedFromUserCode(void*) override
+            {
+                if (m_entered.empty())
+                {
+                    return;
+                }
+                cell_phase previous = m_entered.back();
+                m_entered.pop_back();
+                if (previous != cell_phase::none && m_timer.current() != cell_phase::none)
+                {
+                    m_timer.enter(previous);
+                }
+            }
+
+        private:
+
+            phase_timer& m_timer;
+            std::vector<cell_phase> m_entered;
+        };
+
+        class instantiation_callback : public clang::TemplateInstantiationCallback
+        {
+        public:
+
+            explicit instantiation_callback(phase_timer& timer)
+                : m_timer(timer)
+                , m_depth(0)
+                , m_previous(cell_phase::none)
+            {
+            }
+
+            void initialize(const clang::Sema&) override
+            {
+            }
+
+            void finalize(const clang::Sema&) override
+            {
+            }
+
+            // Only the outermost instantiation switches the phase, the
+            // nested ones are part of its cost.
+            void atTemplateBegin(const clang::Sema&, const clang::Sema::CodeSynthesisContext&) override
+            {
+                if (m_depth++ == 0)
+                {
+                    m_previous = m_timer.current();
+                    if (m_previous != cell_phase::none)
+                    {
+                        m_timer.enter(cell_phase::instantiation);
+                    }
+                }
+            }
+
+            void atTemplateEnd(const clang::Sema&, const clang::Sema::CodeSynthesisContext&) override
+            {
+                if (m_depth > 0 && --m_depth == 0 && m_previous != cell_phase::none
+                    && m_timer.current() == cell_phase::instantiation)
+                {
+                    m_timer.enter(m_previous);
+                }
+            }
+
+        private:
+
+            phase_timer& m_timer;
+            std::size_t m_depth;
+            cell_phase m_previous;
+        };
+    }
+
+    void install_phase_callbacks(cling::Interpreter& interpreter, phase_timer& timer)
+    {
+        // cling adds the callbacks to the ones it already has, such as the
+        // ones of the autoloading, instead of replacing them.
+        interpreter.setCallbacks(std::make_unique<phase_callbacks>(&interpreter, timer));
+        interpreter.getSema().TemplateInstCallbacks.push_back(std::make_unique<instantiation_callback>(timer));
+    }
+}
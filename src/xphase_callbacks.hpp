@@ -0,0 +1,30 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_PHASE_CALLBACKS_HPP
+#define XCPP_PHASE_CALLBACKS_HPP
+
+#include "xphases.hpp"
+
+namespace cling
+{
+    class Interpreter;
+}
+
+namespace xcpp
+{
+    /**
+     * Lets the interpreter switch the phase of the timer when a transaction
+     * is handed to the JIT, when user code is entered and left, and around
+     * the outermost template instantiations.
+     */
+    void install_phase_callbacks(cling::Interpreter& interpreter, phase_timer& timer);
+}
+
+#endif
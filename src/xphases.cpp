@@ -0,0 +1,144 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "xcpp/xtimeit.hpp"
+
+#include "xphases.hpp"
+
+namespace xcpp
+{
+    const char* phase_name(cell_phase phase)
+    {
+        switch (phase)
+        {
+            case cell_phase::magics:
+                return "magics";
+            case cell_phase::split:
+                return "split";
+            case cell_phase::parse:
+                return "parse";
+            case cell_phase::instantiation:
+                return "instantiation";
+            case cell_phase::jit:
+                return "jit";
+            case cell_phase::execution:
+                return "execution";
+            case cell_phase::display:
+                return "display";
+            case cell_phase::publish:
+                return "publish";
+            default:
+                return "none";
+        }
+    }
+
+    /*********************************
+     * Implementation of phase_timer *
+     *********************************/
+
+    phase_timer::phase_timer()
+        : m_durations()
+        , m_current(cell_phase::none)
+        , m_start()
+        , m_entered()
+        , m_stopped()
+    {
+    }
+
+    void phase_timer::start(cell_phase phase)
+    {
+        m_durations.fill(clock_type::duration::zero());
+        m_current = cell_phase::none;
+        m_start = clock_type::now();
+        m_entered = m_start;
+        enter(phase);
+    }
+
+    void phase_timer::enter(cell_phase phase)
+    {
+        clock_type::time_point now = clock_type::now();
+        if (m_current != cell_phase::none)
+        {
+            m_durations[static_cast<std::size_t>(m_current)] += now - m_entered;
+        }
+        m_current = phase;
+        m_entered = now;
+    }
+
+    void phase_timer::stop()
+    {
+        enter(cell_phase::none);
+        m_stopped = m_entered;
+    }
+
+    cell_phase phase_timer::current() const
+    {
+        return m_current;
+    }
+
+    double phase_timer::duration(cell_phase phase) const
+    {
+        if (phase == cell_phase::none)
+        {
+            return 0.;
+        }
+        clock_type::duration res = m_durations[static_cast<std::size_t>(phase)];
+        if (phase == m_current)
+        {
+            res += clock_type::now() - m_entered;
+        }
+        return std::chrono::duration<double>(res).count();
+    }
+
+    double phase_timer::total() const
+    {
+        clock_type::time_point end = m_current == cell_phase::none ? m_stopped : clock_type::now();
+        return std::chrono::duration<double>(end - m_start).count();
+    }
+
+    nl::json phase_timer::to_json() const
+    {
+        nl::json phases = nl::json::object();
+        for (std::size_t i = 0; i < cell_phase_count; ++i)
+        {
+            cell_phase phase = static_cast<cell_phase>(i);
+            phases[phase_name(phase)] = duration(phase);
+        }
+        nl::json res;
+        res["total"] = total();
+        res["phases"] = std::move(phases);
+        return res;
+    }
+
+    std::string phase_timer::report() const
+    {
+        double all = total();
+        std::ostringstream os;
+        os << "Total: " << format_timespan(all) << "\n";
+        for (std::size_t i = 0; i < cell_phase_count; ++i)
+        {
+            cell_phase phase = static_cast<cell_phase>(i);
+            double d = duration(phase);
+            if (d <= 0.)
+            {
+                continue;
+            }
+            os << "  " << std::left << std::setw(15) << phase_name(phase) << std::right << std::setw(10)
+               << format_timespan(d) << "  " << std::fixed << std::setprecision(1) << std::setw(5)
+               << (all > 0. ? 100. * d / all : 0.) << " %\n";
+            os.unsetf(std::ios_base::fixed);
+        }
+        return os.str();
+    }
+}
@@ -0,0 +1,83 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_PHASES_HPP
+#define XCPP_PHASES_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    // The phases of the execution of a cell. Code generation to LLVM IR
+    // happens at the end of parsing and is counted with it.
+    enum class cell_phase
+    {
+        magics,
+        split,
+        parse,
+        instantiation,
+        jit,
+        execution,
+        display,
+        publish,
+        none
+    };
+
+    constexpr std::size_t cell_phase_count = static_cast<std::size_t>(cell_phase::none);
+
+    const char* phase_name(cell_phase phase);
+
+    /**
+     * Accumulates the time spent in each phase of the execution of a cell,
+     * measured with a monotonic clock. The time between enter(a) and the
+     * next call to enter, or to stop, is added to the phase a.
+     */
+    class phase_timer
+    {
+    public:
+
+        using clock_type = std::chrono::steady_clock;
+
+        phase_timer();
+
+        // Clears the durations and enters the given phase.
+        void start(cell_phase phase);
+        void enter(cell_phase phase);
+        void stop();
+
+        cell_phase current() const;
+
+        // Durations in seconds, including the current phase up to now.
+        double duration(cell_phase phase) const;
+        double total() const;
+
+        // {"total": seconds, "phases": {"parse": seconds, ...}}
+        nl::json to_json() const;
+
+        // One line per phase which took time, with its share of the total.
+        std::string report() const;
+
+    private:
+
+        std::array<clock_type::duration, cell_phase_count> m_durations;
+        cell_phase m_current;
+        clock_type::time_point m_start;
+        clock_type::time_point m_entered;
+        clock_type::time_point m_stopped;
+    };
+}
+
+#endif
@@ -0,0 +1,295 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if (defined(__GLIBC__) || defined(__APPLE__)) && (defined(__x86_64__) || defined(__aarch64__))
+#define XCPP_HAS_SAMPLING
+#include <pthread.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif
+
+#include "xsampler.hpp"
+
+namespace xcpp
+{
+#ifdef XCPP_HAS_SAMPLING
+    static std::atomic<stack_sampler*> active_sampler(nullptr);
+    static struct sigaction previous_action;
+
+    // Instruction, frame and stack pointers of the interrupted code.
+    static void interrupted_registers(void* context, void*& pc, void*& fp, void*& sp)
+    {
+        ucontext_t* uc = static_cast<ucontext_t*>(context);
+#if defined(__linux__) && defined(__x86_64__)
+        pc = reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RIP]);
+        fp = reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RBP]);
+        sp = reinterpret_cast<void*>(uc->uc_mcontext.gregs[REG_RSP]);
+#elif defined(__linux__) && defined(__aarch64__)
+        pc = reinterpret_cast<void*>(uc->uc_mcontext.pc);
+        fp = reinterpret_cast<void*>(uc->uc_mcontext.regs[29]);
+        sp = reinterpret_cast<void*>(uc->uc_mcontext.sp);
+#elif defined(__APPLE__) && defined(__x86_64__)
+        pc = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__rip);
+        fp = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__rbp);
+        sp = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__rsp);
+#elif defined(__APPLE__) && defined(__aarch64__)
+        pc = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__pc);
+        fp = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__fp);
+        sp = reinterpret_cast<void*>(uc->uc_mcontext->__ss.__sp);
+#endif
+    }
+
+    // Bounds of the stack of the calling thread.
+    static bool thread_stack(std::uintptr_t& low, std::uintptr_t& high)
+    {
+#ifdef __APPLE__
+        pthread_t self = ::pthread_self();
+        high = reinterpret_cast<std::uintptr_t>(::pthread_get_stackaddr_np(self));
+        low = high - ::pthread_get_stacksize_np(self);
+        return true;
+#else
+        pthread_attr_t attr;
+        if (::pthread_getattr_np(::pthread_self(), &attr) != 0)
+        {
+            return false;
+        }
+        void* addr = nullptr;
+        std::size_t size = 0;
+        bool res = ::pthread_attr_getstack(&attr, &addr, &size) == 0;
+        ::pthread_attr_destroy(&attr);
+        low = reinterpret_cast<std::uintptr_t>(addr);
+        high = low + size;
+        return res;
+#endif
+    }
+
+    static void on_sigprof(int signum, siginfo_t* info, void* context)
+    {
+        int saved_errno = errno;
+        if (stack_sampler* sampler = active_sampler.load(std::memory_order_acquire))
+        {
+            void* pc = nullptr;
+            void* fp = nullptr;
+            void* sp = nullptr;
+            interrupted_registers(context, pc, fp, sp);
+            sampler->record(pc, fp, sp);
+        }
+        else if (previous_action.sa_flags & SA_SIGINFO)
+        {
+            if (previous_action.sa_sigaction != nullptr)
+            {
+                previous_action.sa_sigaction(signum, info, context);
+            }
+        }
+        else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN)
+        {
+            previous_action.sa_handler(signum);
+        }
+        errno = saved_errno;
+    }
+
+    // The handler stays installed once the first sampler has started, so
+    // that a signal still pending when sampling stops is ignored instead of
+    // terminating the process.
+    static bool install_handler()
+    {
+        static bool installed = false;
+        if (!installed)
+        {
+            struct sigaction action;
+            std::memset(&action, 0, sizeof(action));
+            action.sa_sigaction = on_sigprof;
+            action.sa_flags = SA_SIGINFO | SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            installed = ::sigaction(SIGPROF, &action, &previous_action) == 0;
+        }
+        return installed;
+    }
+#endif
+
+    stack_sampler::stack_sampler(long interval_us, std::size_t max_samples, std::size_t max_depth)
+        : m_interval_us(std::max(interval_us, 1L))
+        , m_max_samples(max_samples)
+        , m_max_depth(std::max(max_depth, std::size_t(1)))
+        , m_frames(max_samples * m_max_depth, nullptr)
+        , m_depths(max_samples, 0)
+        , m_count(0)
+        , m_stack_low(0)
+        , m_stack_high(0)
+        , m_running(false)
+        , m_message()
+    {
+    }
+
+    stack_sampler::~stack_sampler()
+    {
+        stop();
+    }
+
+    bool stack_sampler::start()
+    {
+#ifdef XCPP_HAS_SAMPLING
+        // The frames are read in the signal handler, which cannot call the
+        // unwinder of the runtime since it takes locks. They are checked
+        // against the bounds of the stack found here instead.
+        if (!thread_stack(m_stack_low, m_stack_high))
+        {
+            m_message = "cannot find the stack of the thread";
+            return false;
+        }
+
+        stack_sampler* expected = nullptr;
+        if (!active_sampler.compare_exchange_strong(expected, this))
+        {
+            m_message = "another profiler is running";
+            return false;
+        }
+        if (!install_handler())
+        {
+            active_sampler.store(nullptr);
+            m_message = std::string("cannot install the SIGPROF handler: ") + std::strerror(errno);
+            return false;
+        }
+
+#ifdef __linux__
+        // A timer on the CPU time of this thread only, so that the idle
+        // threads of the kernel and the threads started by the cell do not
+        // receive the signals.
+        sigevent event;
+        std::memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = static_cast<pid_t>(::syscall(SYS_gettid));
+        if (::timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &m_timer) != 0)
+        {
+            active_sampler.store(nullptr);
+            m_message = std::string("cannot create the profiling timer: ") + std::strerror(errno);
+            return false;
+        }
+        itimerspec spec;
+        spec.it_interval.tv_sec = m_interval_us / 1000000;
+        spec.it_interval.tv_nsec = (m_interval_us % 1000000) * 1000;
+        spec.it_value = spec.it_interval;
+        ::timer_settime(m_timer, 0, &spec, nullptr);
+#else
+        itimerval spec;
+        spec.it_interval.tv_sec = m_interval_us / 1000000;
+        spec.it_interval.tv_usec = m_interval_us % 1000000;
+        spec.it_value = spec.it_interval;
+        ::setitimer(ITIMER_PROF, &spec, nullptr);
+#endif
+        m_running = true;
+        return true;
+#else
+        m_message = "sampling is not supported on this platform";
+        return false;
+#endif
+    }
+
+    void stack_sampler::stop()
+    {
+#ifdef XCPP_HAS_SAMPLING
+        if (!m_running)
+        {
+            return;
+        }
+#ifdef __linux__
+        ::timer_delete(m_timer);
+#else
+        itimerval spec;
+        std::memset(&spec, 0, sizeof(spec));
+        ::setitimer(ITIMER_PROF, &spec, nullptr);
+#endif
+        active_sampler.store(nullptr, std::memory_order_release);
+        m_running = false;
+#endif
+    }
+
+    void stack_sampler::record(void* pc, void* fp, void* sp)
+    {
+#ifdef XCPP_HAS_SAMPLING
+        std::size_t index = m_count.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_max_samples)
+        {
+            return;
+        }
+        void** frames = &m_frames[index * m_max_depth];
+        std::size_t depth = 0;
+        frames[depth++] = pc;
+
+        // Each frame record holds the frame pointer of the caller followed
+        // by the return address. A record is only read if it lies in the
+        // live part of the stack, above the previous one, so that a frame
+        // pointer clobbered by code compiled without frame pointers ends
+        // the walk instead of faulting.
+        const std::uintptr_t record_size = 2 * sizeof(void*);
+        std::uintptr_t low = std::max(reinterpret_cast<std::uintptr_t>(sp), m_stack_low);
+        std::uintptr_t frame = reinterpret_cast<std::uintptr_t>(fp);
+        while (depth < m_max_depth && frame >= low && frame % sizeof(void*) == 0
+               && frame <= m_stack_high - record_size)
+        {
+            void* const* record = reinterpret_cast<void* const*>(frame);
+            if (record[1] == nullptr)
+            {
+                break;
+            }
+            frames[depth++] = record[1];
+            low = frame + record_size;
+            frame = reinterpret_cast<std::uintptr_t>(record[0]);
+        }
+        m_depths[index] = static_cast<int>(depth);
+#else
+        (void)pc;
+        (void)fp;
+        (void)sp;
+#endif
+    }
+
+    std::vector<std::vector<void*>> stack_sampler::samples() const
+    {
+        std::size_t count = std::min(m_count.load(), m_max_samples);
+        std::vector<std::vector<void*>> res;
+        res.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            void* const* frames = &m_frames[i * m_max_depth];
+            res.emplace_back(frames, frames + m_depths[i]);
+        }
+        return res;
+    }
+
+    std::size_t stack_sampler::dropped() const
+    {
+        std::size_t count = m_count.load();
+        return count > m_max_samples ? count - m_max_samples : 0;
+    }
+
+    const std::string& stack_sampler::message() const
+    {
+        return m_message;
+    }
+}
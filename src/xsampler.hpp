@@ -0,0 +1,74 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_SAMPLER_HPP
+#define XCPP_SAMPLER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+namespace xcpp
+{
+    /**
+     * Samples the call stack of the calling thread each time it has used
+     * interval_us microseconds of CPU time, from a SIGPROF handler. The
+     * stacks are walked through the frame pointers and written to memory
+     * allocated beforehand, samples beyond max_samples are dropped. Only one
+     * sampler can run at a time; this is a no-op on Windows.
+     */
+    class stack_sampler
+    {
+    public:
+
+        stack_sampler(long interval_us, std::size_t max_samples, std::size_t max_depth);
+        ~stack_sampler();
+
+        stack_sampler(const stack_sampler&) = delete;
+        stack_sampler& operator=(const stack_sampler&) = delete;
+
+        // Returns false, with the reason in message(), if sampling cannot start.
+        bool start();
+        void stop();
+
+        // Return addresses of each sample, innermost frame first.
+        std::vector<std::vector<void*>> samples() const;
+        std::size_t dropped() const;
+
+        const std::string& message() const;
+
+        // Called by the signal handler, with the instruction, frame and stack
+        // pointers of the interrupted code.
+        void record(void* pc, void* fp, void* sp);
+
+    private:
+
+        long m_interval_us;
+        std::size_t m_max_samples;
+        std::size_t m_max_depth;
+        std::vector<void*> m_frames;
+        std::vector<int> m_depths;
+        std::atomic<std::size_t> m_count;
+        std::uintptr_t m_stack_low;
+        std::uintptr_t m_stack_high;
+        bool m_running;
+        std::string m_message;
+#ifdef __linux__
+        timer_t m_timer;
+#endif
+    };
+}
+
+#endif
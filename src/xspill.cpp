@@ -0,0 +1,199 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include "xspill.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace xcpp
+{
+    static fs::path session_path()
+    {
+#ifdef _WIN32
+        int pid = _getpid();
+#else
+        int pid = ::getpid();
+#endif
+        std::error_code ec;
+        fs::path tmp = fs::temp_directory_path(ec);
+        if (ec)
+        {
+            tmp = fs::current_path(ec);
+        }
+        return tmp / ("xeus-cling-" + std::to_string(pid));
+    }
+
+    std::string session_directory()
+    {
+        static const fs::path path = session_path();
+        return path.string();
+    }
+
+    void remove_session_directory()
+    {
+        std::error_code ec;
+        fs::remove_all(session_directory(), ec);
+    }
+
+    /********************************
+     * Implementation of spill_file *
+     ********************************/
+
+    // Size of the mapped part of the file, a multiple of the page size.
+    static constexpr std::size_t window_size = std::size_t(1) << 22;
+
+    spill_file::spill_file(std::string path)
+        : m_path(std::move(path))
+        , m_size(0)
+        , m_failed(false)
+#ifdef _WIN32
+        , p_file(nullptr)
+#else
+        , m_fd(-1)
+        , p_window(nullptr)
+        , m_window_offset(0)
+#endif
+    {
+    }
+
+    spill_file::~spill_file()
+    {
+        close();
+    }
+
+    const std::string& spill_file::path() const
+    {
+        return m_path;
+    }
+
+    std::size_t spill_file::size() const
+    {
+        return m_size;
+    }
+
+    void spill_file::write(const char* s, std::size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (count == 0 || !open())
+        {
+            return;
+        }
+#ifdef _WIN32
+        m_size += std::fwrite(s, 1, count, p_file);
+#else
+        while (count != 0)
+        {
+            if (p_window == nullptr || m_size == m_window_offset + window_size)
+            {
+                if (!map_window(m_size - m_size % window_size))
+                {
+                    return;
+                }
+            }
+            std::size_t size = std::min(count, m_window_offset + window_size - m_size);
+            std::memcpy(p_window + (m_size - m_window_offset), s, size);
+            m_size += size;
+            s += size;
+            count -= size;
+        }
+#endif
+    }
+
+    bool spill_file::open()
+    {
+        if (m_failed)
+        {
+            return false;
+        }
+        std::error_code ec;
+#ifdef _WIN32
+        if (p_file == nullptr)
+        {
+            fs::create_directories(fs::path(m_path).parent_path(), ec);
+            p_file = std::fopen(m_path.c_str(), "wb");
+            m_failed = p_file == nullptr;
+        }
+#else
+        if (m_fd < 0)
+        {
+            fs::create_directories(fs::path(m_path).parent_path(), ec);
+            m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+            m_failed = m_fd < 0;
+        }
+#endif
+        return !m_failed;
+    }
+
+    bool spill_file::map_window(std::size_t offset)
+    {
+#ifndef _WIN32
+        if (p_window != nullptr)
+        {
+            ::munmap(p_window, window_size);
+            p_window = nullptr;
+        }
+        if (::ftruncate(m_fd, static_cast<off_t>(offset + window_size)) != 0)
+        {
+            m_failed = true;
+            return false;
+        }
+        void* window = ::mmap(nullptr, window_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+        if (window == MAP_FAILED)
+        {
+            m_failed = true;
+            return false;
+        }
+        p_window = static_cast<char*>(window);
+        m_window_offset = offset;
+#endif
+        return true;
+    }
+
+    void spill_file::close()
+    {
+#ifdef _WIN32
+        if (p_file != nullptr)
+        {
+            std::fclose(p_file);
+            p_file = nullptr;
+        }
+#else
+        if (p_window != nullptr)
+        {
+            ::munmap(p_window, window_size);
+            p_window = nullptr;
+        }
+        if (m_fd >= 0)
+        {
+            // Drop the unused tail of the last window.
+            (void) ::ftruncate(m_fd, static_cast<off_t>(m_size));
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+    }
+}
@@ -0,0 +1,68 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_SPILL_HPP
+#define XCPP_SPILL_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+namespace xcpp
+{
+    // Temporary directory holding the files of the current kernel session.
+    // It is created by the first spill_file written to it.
+    std::string session_directory();
+    void remove_session_directory();
+
+    /**
+     * Append-only file receiving the output of a cell past its budget.
+     *
+     * The file is created on the first write, and written through a
+     * memory-mapped window which is moved forward as the file grows, so
+     * that the memory used does not depend on the amount of output. Falls
+     * back to stdio on Windows. Writes may come from several threads.
+     */
+    class spill_file
+    {
+    public:
+
+        explicit spill_file(std::string path);
+        ~spill_file();
+
+        spill_file(const spill_file&) = delete;
+        spill_file& operator=(const spill_file&) = delete;
+
+        const std::string& path() const;
+        std::size_t size() const;
+
+        void write(const char* s, std::size_t count);
+
+    private:
+
+        bool open();
+        bool map_window(std::size_t offset);
+        void close();
+
+        std::string m_path;
+        std::size_t m_size;
+        bool m_failed;
+        std::mutex m_mutex;
+#ifdef _WIN32
+        std::FILE* p_file;
+#else
+        int m_fd;
+        char* p_window;
+        std::size_t m_window_offset;
+#endif
+    };
+}
+
+#endif
@@ -0,0 +1,114 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include "xdemangle.hpp"
+#include "xsymbolizer.hpp"
+
+#if defined(__GLIBC__)
+// Exported by the unwinder (libgcc_s or libunwind), which also knows the
+// unwind tables registered by the JIT.
+struct dwarf_eh_bases
+{
+    void* tbase;
+    void* dbase;
+    void* func;
+};
+
+extern "C" const void* _Unwind_Find_FDE(void* pc, dwarf_eh_bases* bases);
+#endif
+
+namespace xcpp
+{
+    static std::string demangled(const char* name)
+    {
+        const char* res = demangle(name);
+        if (res == nullptr)
+        {
+            return name;
+        }
+        std::string str = res;
+#if defined(XEUS_HAS_CXXABI_H)
+        std::free(const_cast<char*>(res));
+#endif
+        return str;
+    }
+
+    static std::string hex(const void* address)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%p", address);
+        return buf;
+    }
+
+    /********************************
+     * Implementation of symbolizer *
+     ********************************/
+
+    symbolizer::symbolizer(const jit_symbols& symbols)
+        : m_symbols(symbols)
+    {
+    }
+
+    const frame_symbol& symbolizer::operator()(void* address, bool innermost)
+    {
+        auto it = m_cache.find(address);
+        if (it == m_cache.end())
+        {
+            void* lookup = innermost ? address : static_cast<char*>(address) - 1;
+            it = m_cache.emplace(address, resolve(lookup)).first;
+        }
+        return it->second;
+    }
+
+    frame_symbol symbolizer::resolve(void* address) const
+    {
+#ifndef _WIN32
+        Dl_info info;
+        if (::dladdr(address, &info) != 0 && info.dli_fname != nullptr)
+        {
+            if (info.dli_sname != nullptr)
+            {
+                return {demangled(info.dli_sname), false, nullptr};
+            }
+            std::string library = info.dli_fname;
+            return {"[" + library.substr(library.find_last_of('/') + 1) + "]", false, nullptr};
+        }
+#endif
+        const void* start = nullptr;
+#if defined(__GLIBC__)
+        dwarf_eh_bases bases;
+        if (_Unwind_Find_FDE(address, &bases) != nullptr)
+        {
+            start = bases.func;
+        }
+#endif
+        const std::string* name = nullptr;
+        if (start != nullptr)
+        {
+            name = m_symbols.at(start);
+        }
+        else
+        {
+            name = m_symbols.find(address, &start);
+        }
+        if (name != nullptr)
+        {
+            return {*name, true, start};
+        }
+        return {"[jit] " + hex(start != nullptr ? start : address), true, start};
+    }
+}
@@ -0,0 +1,53 @@
+/************************************************************************************
+ * Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+ * Copyright (c) 2016, QuantStack                                                   *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XCPP_SYMBOLIZER_HPP
+#define XCPP_SYMBOLIZER_HPP
+
+#include <string>
+#include <unordered_map>
+
+#include "xjit_symbols.hpp"
+
+namespace xcpp
+{
+    struct frame_symbol
+    {
+        std::string name;
+        bool jit;
+        // Start of the function compiled by the JIT, or nullptr.
+        const void* start;
+    };
+
+    /**
+     * Names the functions of the frames of a call stack. Functions of the
+     * loaded libraries are found by dladdr, those compiled by the JIT are
+     * not in any library and are looked up in the JIT symbols, from the
+     * start of the function given by its unwind table.
+     */
+    class symbolizer
+    {
+    public:
+
+        explicit symbolizer(const jit_symbols& symbols);
+
+        // Return addresses point after the call, hence the lookup one byte
+        // before them for the frames other than the innermost one.
+        const frame_symbol& operator()(void* address, bool innermost);
+
+    private:
+
+        frame_symbol resolve(void* address) const;
+
+        const jit_symbols& m_symbols;
+        std::unordered_map<void*, frame_symbol> m_cache;
+    };
+}
+
+#endif
@@ -0,0 +1,124 @@
+#############################################################################
+# Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay           #
+# Copyright (c) 2016, QuantStack                                            #
+#                                                                           #
+# Distributed under the terms of the BSD 3-Clause License.                  #
+#                                                                           #
+# The full license is in the file LICENSE, distributed with this software.  #
+#############################################################################
+
+# Measures the time %%executable takes to generate the object code of a
+# session using header-heavy libraries, in one partition and in several
+# partitions compiled by concurrent processes. Only the code generation of
+# %%executable is measured: the cells executed by the kernel are compiled
+# by the JIT of cling, on one thread. Cell sets whose headers are not
+# installed are skipped.
+#
+# Usage: python benchmark_codegen.py [--kernel xcpp17] [--jobs 8]
+
+import argparse
+import os
+import re
+import tempfile
+
+from jupyter_client.manager import start_new_kernel
+
+# Many small functions, as in a cell pasted from a source file.
+FUNCTIONS = '\n'.join(
+    'double f{0}(double x) {{ return x * {0} + (x > {0} ? f{1}(x - 1) : 0.); }}'.format(i, max(i - 1, 0))
+    for i in range(300)
+)
+
+CELL_SETS = [
+    (
+        'functions',
+        '#include <cmath>',
+        FUNCTIONS + '\ndouble r = f299(310.);',
+        'return f299(310.) > 0 ? 0 : 1;',
+    ),
+    (
+        'standard library',
+        '#include <map>\n#include <random>\n#include <regex>\n#include <string>\n#include <unordered_map>',
+        'std::mt19937 gen(42);\n'
+        'std::normal_distribution<double> dist;\n'
+        'std::map<std::string, double> m;\n'
+        'std::unordered_map<int, std::string> u;\n'
+        'for (int i = 0; i < 100; ++i) { m[std::to_string(i)] = dist(gen); u[i] = std::to_string(i); }\n'
+        'bool match = std::regex_match("aaab", std::regex("a+b"));',
+        'return match ? 0 : 1;',
+    ),
+    (
+        'xtensor',
+        '#include <xtensor/xarray.hpp>\n#include <xtensor/xmath.hpp>\n#include <xtensor/xrandom.hpp>',
+        'xt::xarray<double> a = xt::random::rand<double>({100, 100});\n'
+        'xt::xarray<double> b = xt::sum(xt::exp(a) * a, {1});\n'
+        'double s = xt::amax(b)();',
+        'return s > 0 ? 0 : 1;',
+    ),
+    (
+        'Eigen',
+        '#include <Eigen/Dense>',
+        'Eigen::MatrixXd m = Eigen::MatrixXd::Random(64, 64);\n'
+        'Eigen::MatrixXd n = m * m.transpose();\n'
+        'double d = n.llt().matrixL().determinant();',
+        'return d > 0 ? 0 : 1;',
+    ),
+]
+
+
+def execute(client, code):
+    reply = client.execute(code, reply=True, timeout=600)
+    return reply['content']['status'] == 'ok'
+
+
+def execute_output(client, code):
+    msg_id = client.execute(code)
+    output = ''
+    while True:
+        msg = client.get_iopub_msg(timeout=600)
+        if msg['parent_header'].get('msg_id') != msg_id:
+            continue
+        if msg['msg_type'] == 'stream':
+            output += msg['content']['text']
+        elif msg['msg_type'] == 'status' and msg['content']['execution_state'] == 'idle':
+            return output
+
+
+def codegen_time(client, exe, jobs, main):
+    output = execute_output(client, '%%executable {} -j {}\n{}'.format(exe, jobs, main))
+    match = re.search(r'Generated object code in (.*) on', output)
+    return match.group(1) if match else 'failed'
+
+
+def run(kernel_name, jobs, name, includes, body, main):
+    manager, client = start_new_kernel(kernel_name=kernel_name)
+    try:
+        if not execute(client, includes):
+            print('{:>16}: skipped, the headers are not available'.format(name))
+            return
+        if not execute(client, body):
+            print('{:>16}: skipped, the cell failed'.format(name))
+            return
+        with tempfile.TemporaryDirectory() as directory:
+            exe = os.path.join(directory, 'benchmark')
+            serial = codegen_time(client, exe, 1, main)
+            parallel = codegen_time(client, exe, jobs, main)
+    finally:
+        client.stop_channels()
+        manager.shutdown_kernel(now=True)
+
+    print('{:>16}: %%executable object code in 1 partition {:>10}, in {} partitions {:>10}'.format(
+        name, serial, jobs, parallel))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--kernel', default='xcpp17')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    args = parser.parse_args()
+    for cell_set in CELL_SETS:
+        run(args.kernel, args.jobs, *cell_set)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,94 @@
+#############################################################################
+# Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay           #
+# Copyright (c) 2016, QuantStack                                            #
+#                                                                           #
+# Distributed under the terms of the BSD 3-Clause License.                  #
+#                                                                           #
+# The full license is in the file LICENSE, distributed with this software.  #
+#############################################################################
+
+# Measures the latency of displaying the result of a cell and the number of
+# cling transactions it creates, with and without the cache of display
+# thunks.
+#
+# Usage: python benchmark_display.py [--kernel xcpp17] [--count 1000]
+
+import argparse
+import os
+import statistics
+import time
+
+from jupyter_client.manager import start_new_kernel
+
+SETUP = """
+#include <vector>
+#include <cling/Interpreter/Interpreter.h>
+#include <cling/Interpreter/Transaction.h>
+
+std::vector<double> v(100, 1.5);
+
+std::size_t count_transactions()
+{
+    std::size_t res = 0;
+    for (auto t = cling::runtime::gCling->getFirstTransaction(); t != nullptr; t = t->getNext())
+    {
+        ++res;
+    }
+    return res;
+}
+"""
+
+
+def execute(client, code):
+    msg_id = client.execute(code)
+    result = None
+    while True:
+        msg = client.get_iopub_msg(timeout=60)
+        if msg['parent_header'].get('msg_id') != msg_id:
+            continue
+        if msg['msg_type'] == 'execute_result':
+            result = msg['content']['data'].get('text/plain')
+        elif msg['msg_type'] == 'status' and msg['content']['execution_state'] == 'idle':
+            return result
+
+
+def run(kernel_name, count, cached):
+    env = dict(os.environ)
+    env['XEUS_CLING_DISPLAY_CACHE'] = '1' if cached else '0'
+    manager, client = start_new_kernel(kernel_name=kernel_name, env=env)
+    try:
+        execute(client, SETUP)
+        before = int(execute(client, 'count_transactions()'))
+        latencies = []
+        for _ in range(count):
+            start = time.perf_counter()
+            execute(client, 'v')
+            latencies.append(time.perf_counter() - start)
+        after = int(execute(client, 'count_transactions()'))
+    finally:
+        client.stop_channels()
+        manager.shutdown_kernel(now=True)
+
+    latencies.sort()
+    # One transaction per cell, and one per count_transactions() call.
+    transactions = after - before - count - 1
+    print('{:>8}: median {:8.3f} ms, p95 {:8.3f} ms, max {:8.3f} ms, '
+          '{} display transactions'.format(
+              'cached' if cached else 'uncached',
+              1e3 * statistics.median(latencies),
+              1e3 * latencies[int(0.95 * (len(latencies) - 1))],
+              1e3 * latencies[-1],
+              transactions))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--kernel', default='xcpp17')
+    parser.add_argument('--count', type=int, default=1000)
+    args = parser.parse_args()
+    run(args.kernel, args.count, False)
+    run(args.kernel, args.count, True)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,235 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+// Benchmarks of the output capture. Publishing is simulated by a callback
+// spinning for a fixed amount of time, which stands for the serialization
+// and the ZMQ send of an iopub stream message.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xeus-cling/xbuffer.hpp"
+
+using clock_type = std::chrono::steady_clock;
+
+static void spin_for(std::chrono::microseconds duration)
+{
+    auto end = clock_type::now() + duration;
+    while (clock_type::now() < end)
+    {
+    }
+}
+
+struct endl_loop_result
+{
+    std::size_t messages = 0;
+    double seconds = 0.;
+    double mean_latency = 0.;
+    double max_latency = 0.;
+};
+
+// Writes `lines` lines with std::endl and measures the number of published
+// messages, and the latency between the write of a line and its publication.
+static endl_loop_result
+run_endl_loop(std::size_t lines, const xcpp::xflush_policy& policy, std::chrono::microseconds publish_cost)
+{
+    std::vector<clock_type::time_point> written(lines);
+    std::vector<clock_type::time_point> published(lines);
+    std::size_t published_lines = 0;
+    endl_loop_result res;
+
+    auto callback = [&](const std::string& output)
+    {
+        spin_for(publish_cost);
+        auto now = clock_type::now();
+        auto count = static_cast<std::size_t>(std::count(output.begin(), output.end(), '\n'));
+        for (std::size_t i = 0; i < count && published_lines < lines; ++i)
+        {
+            published[published_lines++] = now;
+        }
+        ++res.messages;
+    };
+
+    auto start = clock_type::now();
+    {
+        xcpp::xoutput_buffer buffer(callback, policy);
+        std::ostream out(&buffer);
+        for (std::size_t i = 0; i < lines; ++i)
+        {
+            written[i] = clock_type::now();
+            out << "line " << i << std::endl;
+        }
+        buffer.flush();
+    }
+    res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    for (std::size_t i = 0; i < published_lines; ++i)
+    {
+        double latency = std::chrono::duration<double>(published[i] - written[i]).count();
+        res.mean_latency += latency;
+        res.max_latency = std::max(res.max_latency, latency);
+    }
+    res.mean_latency /= static_cast<double>(std::max(published_lines, std::size_t(1)));
+    return res;
+}
+
+static void benchmark_endl_loop()
+{
+    const std::size_t lines = 200000;
+    const std::chrono::microseconds publish_cost(20);
+
+    std::cout << "std::endl in a loop: " << lines << " lines, " << publish_cost.count()
+              << " us per published message" << std::endl;
+    std::cout << std::setw(12) << "interval" << std::setw(12) << "messages" << std::setw(14) << "messages/s"
+              << std::setw(12) << "wall (s)" << std::setw(18) << "mean latency (ms)" << std::setw(17)
+              << "max latency (ms)" << std::endl;
+
+    for (auto interval : {0, 10, 50, 200})
+    {
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(interval);
+        policy.max_bytes = std::size_t(1) << 20;
+        auto res = run_endl_loop(lines, policy, publish_cost);
+        std::cout << std::setw(10) << interval << "ms" << std::setw(12) << res.messages << std::setw(14)
+                  << std::fixed << std::setprecision(0) << res.messages / res.seconds << std::setw(12)
+                  << std::setprecision(3) << res.seconds << std::setw(18) << res.mean_latency * 1e3
+                  << std::setw(17) << res.max_latency * 1e3 << std::endl;
+    }
+}
+
+// Previous implementation of the output capture: a mutex taken for every
+// character, and held while publishing.
+class mutex_buffer : public std::streambuf
+{
+public:
+
+    using callback_type = std::function<void(const std::string&)>;
+
+    explicit mutex_buffer(callback_type callback)
+        : m_callback(std::move(callback))
+    {
+    }
+
+protected:
+
+    traits_type::int_type overflow(traits_type::int_type c) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            m_output.push_back(traits_type::to_char_type(c));
+        }
+        return c;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_output.append(s, count);
+        return count;
+    }
+
+    traits_type::int_type sync() override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_output.empty())
+        {
+            m_callback(m_output);
+            m_output.clear();
+        }
+        return 0;
+    }
+
+private:
+
+    callback_type m_callback;
+    std::string m_output;
+    std::mutex m_mutex;
+};
+
+// Each thread logs `lines` lines, flushing every line as std::endl does.
+// Returns the number of bytes written per second.
+static double run_writers(std::streambuf& buffer, std::size_t nthreads, std::size_t lines)
+{
+    std::vector<std::thread> writers;
+    auto start = clock_type::now();
+    for (std::size_t t = 0; t < nthreads; ++t)
+    {
+        writers.emplace_back(
+            [&buffer, t, lines]()
+            {
+                std::ostream out(&buffer);
+                for (std::size_t i = 0; i < lines; ++i)
+                {
+                    out << "worker " << t << " step " << i << " residual " << 1e-3 / (i + 1) << std::endl;
+                }
+            }
+        );
+    }
+    for (auto& w : writers)
+    {
+        w.join();
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    double bytes = 40. * static_cast<double>(nthreads * lines);
+    return bytes / seconds;
+}
+
+static void benchmark_writer_threads()
+{
+    const std::size_t lines = 20000;
+    const std::chrono::microseconds publish_cost(20);
+    auto callback = [publish_cost](const std::string&)
+    {
+        spin_for(publish_cost);
+    };
+
+    std::cout << "\nWriter throughput: " << lines << " lines per thread, " << publish_cost.count()
+              << " us per published message" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "mutex (MB/s)" << std::setw(16) << "ring (MB/s)"
+              << std::endl;
+
+    for (std::size_t nthreads : {1, 2, 4, 8, 16, 32})
+    {
+        double mutex_throughput = 0.;
+        {
+            mutex_buffer buffer(callback);
+            mutex_throughput = run_writers(buffer, nthreads, lines);
+        }
+
+        double ring_throughput = 0.;
+        {
+            xcpp::xflush_policy policy;
+            policy.interval = std::chrono::milliseconds(200);
+            policy.max_bytes = std::size_t(1) << 20;
+            xcpp::xoutput_buffer buffer(callback, policy);
+            ring_throughput = run_writers(buffer, nthreads, lines);
+            buffer.flush();
+        }
+
+        std::cout << std::setw(8) << nthreads << std::setw(16) << std::fixed << std::setprecision(1)
+                  << mutex_throughput / 1e6 << std::setw(16) << ring_throughput / 1e6 << std::endl;
+    }
+}
+
+int main()
+{
+    benchmark_endl_loop();
+    benchmark_writer_threads();
+    return 0;
+}
@@ -0,0 +1,126 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "xbench_internal.hpp"
+
+TEST_SUITE("bench")
+{
+    TEST_CASE("parse_size")
+    {
+        REQUIRE_EQ(xcpp::parse_size("64"), 64u);
+        REQUIRE_EQ(xcpp::parse_size("4K"), 4096u);
+        REQUIRE_EQ(xcpp::parse_size("4k"), 4096u);
+        REQUIRE_EQ(xcpp::parse_size("2M"), std::size_t(2) << 20);
+        REQUIRE_EQ(xcpp::parse_size("1 G"), std::size_t(1) << 30);
+        REQUIRE_THROWS_AS(xcpp::parse_size("4T"), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_size("K"), std::invalid_argument);
+        std::string too_large = std::to_string(std::numeric_limits<std::size_t>::max()) + "K";
+        REQUIRE_THROWS_AS(xcpp::parse_size(too_large), std::out_of_range);
+    }
+
+    TEST_CASE("parse_parameter_list")
+    {
+        std::string name;
+        std::vector<std::size_t> values = xcpp::parse_parameter("N=1, 2,4K", name);
+        REQUIRE_EQ(name, "N");
+        REQUIRE_EQ(values, std::vector<std::size_t>({1, 2, 4096}));
+    }
+
+    TEST_CASE("parse_parameter_range")
+    {
+        std::string name;
+        REQUIRE_EQ(xcpp::parse_parameter("N=1..512", name), std::vector<std::size_t>({1, 8, 64, 512}));
+        REQUIRE_EQ(xcpp::parse_parameter("N=1..100:10", name), std::vector<std::size_t>({1, 10, 100}));
+        REQUIRE_EQ(xcpp::parse_parameter("N=3..20:4", name), std::vector<std::size_t>({3, 12, 20}));
+        REQUIRE_EQ(xcpp::parse_parameter("N=5..5", name), std::vector<std::size_t>({5}));
+    }
+
+    TEST_CASE("parse_parameter_large_range")
+    {
+        // The values past the last one would not fit in a size_t.
+        std::string name;
+        std::size_t max = std::numeric_limits<std::size_t>::max();
+        std::vector<std::size_t> values = xcpp::parse_parameter("N=1.." + std::to_string(max) + ":2", name);
+        REQUIRE_EQ(values.size(), std::size_t(std::numeric_limits<std::size_t>::digits + 1));
+        REQUIRE_EQ(values.back(), max);
+    }
+
+    TEST_CASE("parse_parameter_invalid")
+    {
+        std::string name;
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("1,2,4", name), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("=1,2", name), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("N=", name), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("N=1..8:1", name), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("N=0..8", name), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_parameter("N=8..1", name), std::invalid_argument);
+    }
+
+    TEST_CASE("mann_whitney")
+    {
+        // U = 0 for fully separated samples, the p-value is the one of
+        // the normal approximation with continuity correction.
+        std::vector<double> x = {1., 2., 3.};
+        std::vector<double> y = {4., 5., 6.};
+        REQUIRE_LT(std::abs(xcpp::mann_whitney(x, y) - 0.0808556), 1e-6);
+        REQUIRE_LT(std::abs(xcpp::mann_whitney(y, x) - 0.0808556), 1e-6);
+        REQUIRE_EQ(xcpp::mann_whitney(x, x), 1.);
+        REQUIRE_EQ(xcpp::mann_whitney(x, {}), 1.);
+    }
+
+    TEST_CASE("mann_whitney_ties")
+    {
+        // Tied values share their average rank: U = 6, and the variance
+        // is corrected for the two groups of three ties.
+        std::vector<double> x = {1., 1., 2., 3.};
+        std::vector<double> y = {1., 2., 2., 4.};
+        REQUIRE_LT(std::abs(xcpp::mann_whitney(x, y) - 0.6489418), 1e-6);
+        // All the values are tied, the variance is zero.
+        std::vector<double> same = {3., 3., 3.};
+        REQUIRE_EQ(xcpp::mann_whitney(same, {3., 3.}), 1.);
+    }
+
+    TEST_CASE("split_values")
+    {
+        REQUIRE_EQ(xcpp::split_values("a, f(b, c), {d, e}"),
+                   std::vector<std::string>({"a", "f(b, c)", "{d, e}"}));
+        REQUIRE_EQ(xcpp::split_values(" , a,,b "), std::vector<std::string>({"a", "b"}));
+    }
+
+    TEST_CASE("parse_search_space")
+    {
+        xcpp::tune_parameter parameter;
+        REQUIRE(xcpp::parse_search_space("  BLOCK_SIZE in {16, 32, std::max(1, 64)}", parameter));
+        REQUIRE_EQ(parameter.name, "BLOCK_SIZE");
+        REQUIRE_EQ(parameter.values, std::vector<std::string>({"16", "32", "std::max(1, 64)"}));
+    }
+
+    TEST_CASE("parse_search_space_malformed")
+    {
+        xcpp::tune_parameter parameter;
+        REQUIRE_FALSE(xcpp::parse_search_space("", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("int x = 0;", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("1N in {1, 2}", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("N in 1, 2", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("N in {1, 2", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("N = {1, 2}", parameter));
+        REQUIRE_FALSE(xcpp::parse_search_space("in {1, 2}", parameter));
+        REQUIRE_THROWS_AS(xcpp::parse_search_space("N in {}", parameter), std::invalid_argument);
+        REQUIRE_THROWS_AS(xcpp::parse_search_space("N in { , }", parameter), std::invalid_argument);
+    }
+}
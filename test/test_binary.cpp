@@ -0,0 +1,116 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "xcpp/xbinary.hpp"
+
+namespace
+{
+    std::vector<unsigned char> base64_decode(const std::string& text)
+    {
+        static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::vector<unsigned char> res;
+        std::uint32_t n = 0;
+        int bits = 0;
+        for (char c : text)
+        {
+            if (c == '=')
+            {
+                break;
+            }
+            n = (n << 6) | static_cast<std::uint32_t>(alphabet.find(c));
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                res.push_back(static_cast<unsigned char>((n >> bits) & 0xFF));
+            }
+        }
+        return res;
+    }
+
+    void write_file(const std::string& path, const std::string& content)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << content;
+    }
+}
+
+TEST_SUITE("binary")
+{
+    TEST_CASE("base64_encode")
+    {
+        // Test vectors of RFC 4648.
+        REQUIRE_EQ(xcpp::base64_encode(std::string("")), "");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("f")), "Zg==");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("fo")), "Zm8=");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("foo")), "Zm9v");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("foob")), "Zm9vYg==");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("fooba")), "Zm9vYmE=");
+        REQUIRE_EQ(xcpp::base64_encode(std::string("foobar")), "Zm9vYmFy");
+    }
+
+    TEST_CASE("base64_all_bytes")
+    {
+        std::vector<unsigned char> bytes;
+        for (int i = 0; i < 256; ++i)
+        {
+            bytes.push_back(static_cast<unsigned char>(255 - i));
+        }
+        REQUIRE_EQ(xcpp::base64_encode(std::vector<unsigned char>(3, 0xFF)), "////");
+        for (std::size_t size = 0; size <= bytes.size(); size += 37)
+        {
+            std::vector<unsigned char> part(bytes.begin(), bytes.begin() + static_cast<std::ptrdiff_t>(size));
+            std::string text = xcpp::base64_encode(part);
+            REQUIRE_EQ(text.size(), 4 * ((size + 2) / 3));
+            REQUIRE(base64_decode(text) == part);
+        }
+    }
+
+    TEST_CASE("mapped_file")
+    {
+        std::string path = "test_binary_mapped.bin";
+        std::string content("\x89PNG\r\n\x1a\n\0\xff", 10);
+        write_file(path, content);
+        {
+            xcpp::mapped_file file(path);
+            xcpp::bytes_view bytes = file.bytes();
+            REQUIRE_EQ(bytes.size, content.size());
+            REQUIRE_EQ(std::string(static_cast<const char*>(bytes.data), bytes.size), content);
+        }
+
+        // Empty files cannot be mapped and are read instead.
+        write_file(path, "");
+        {
+            xcpp::mapped_file file(path);
+            REQUIRE_EQ(file.bytes().size, 0u);
+        }
+        std::remove(path.c_str());
+
+        REQUIRE_THROWS_AS(xcpp::mapped_file("test_binary_missing.bin"), std::runtime_error);
+    }
+
+    TEST_CASE("binary_file")
+    {
+        std::string path = "test_binary_file.bin";
+        write_file(path, "foobar");
+        nl::json bundle = xcpp::mime_bundle_repr(xcpp::binary_file("image/png", path));
+        std::remove(path.c_str());
+        REQUIRE_EQ(bundle.size(), 1u);
+        REQUIRE_EQ(bundle["image/png"].get<std::string>(), "Zm9vYmFy");
+    }
+}
@@ -0,0 +1,72 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#ifndef _WIN32
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "xeus-cling/xbuffer.hpp"
+
+#include "xcapture.hpp"
+
+TEST_SUITE("capture")
+{
+    TEST_CASE("fd_output")
+    {
+        std::string received;
+        std::vector<std::thread::id> publishers;
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(1);
+        xcpp::xoutput_buffer buffer(
+            [&](const std::string& s)
+            {
+                publishers.push_back(std::this_thread::get_id());
+                received += s;
+            },
+            policy
+        );
+
+        // Any file descriptor can be captured, the standard ones are left
+        // to the test runner.
+        int fd = ::open("/dev/null", O_WRONLY);
+        REQUIRE_GE(fd, 0);
+        {
+            xcpp::fd_capture capture(fd, buffer);
+            REQUIRE(capture.active());
+            REQUIRE_EQ(::write(fd, "native\n", 7), 7);
+
+            // The reader thread forwards the output, but does not publish it.
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            REQUIRE(received.empty());
+
+            capture.drain();
+            buffer.flush();
+            REQUIRE_EQ(received, "native\n");
+            REQUIRE_EQ(publishers.size(), 1u);
+            REQUIRE(publishers.front() == std::this_thread::get_id());
+        }
+
+        // The file descriptor is restored on destruction.
+        received.clear();
+        REQUIRE_EQ(::write(fd, "lost\n", 5), 5);
+        buffer.flush();
+        REQUIRE(received.empty());
+        ::close(fd);
+    }
+}
+
+#endif
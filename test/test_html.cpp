@@ -0,0 +1,47 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <string>
+
+#include "xcpp/xhtml.hpp"
+
+TEST_SUITE("html")
+{
+    TEST_CASE("html_escape")
+    {
+        REQUIRE_EQ(xcpp::detail::html_escape(""), "");
+        REQUIRE_EQ(xcpp::detail::html_escape("computing"), "computing");
+        REQUIRE_EQ(
+            xcpp::detail::html_escape("<script>alert(\"x\")</script>"),
+            "&lt;script&gt;alert(&quot;x&quot;)&lt;/script&gt;"
+        );
+        REQUIRE_EQ(
+            xcpp::detail::html_escape("std::vector<std::pair<int, int>>"),
+            "std::vector&lt;std::pair&lt;int, int&gt;&gt;"
+        );
+    }
+
+    TEST_CASE("html_escape_ampersand")
+    {
+        // Existing entities are escaped as well, so that they are displayed
+        // as they were written.
+        REQUIRE_EQ(xcpp::detail::html_escape("a && b"), "a &amp;&amp; b");
+        REQUIRE_EQ(xcpp::detail::html_escape("&lt;"), "&amp;lt;");
+        REQUIRE_EQ(xcpp::detail::html_escape("operator&"), "operator&amp;");
+    }
+
+    TEST_CASE("html_escape_passthrough")
+    {
+        // Single quotes, non-ASCII bytes and control characters are kept.
+        std::string text = "it's \xc3\xa9t\xc3\xa9\n\t";
+        REQUIRE_EQ(xcpp::detail::html_escape(text), text);
+    }
+}
@@ -0,0 +1,36 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <string>
+#include <vector>
+
+#include "xparser.hpp"
+
+TEST_SUITE("parser")
+{
+    TEST_CASE("split_from_includes")
+    {
+        std::vector<std::string> blocks = xcpp::split_from_includes("#include <vector>\nstd::vector<int> v;\n");
+        REQUIRE_EQ(blocks.size(), 2u);
+        REQUIRE_EQ(blocks[0], "#include <vector>\n");
+        REQUIRE_EQ(blocks[1], "std::vector<int> v;");
+    }
+
+    TEST_CASE("split_from_includes_interleaved")
+    {
+        std::vector<std::string> blocks = xcpp::split_from_includes("int i = 0;\n#include <map>\n\nint j = i;");
+        REQUIRE_EQ(blocks.size(), 4u);
+        REQUIRE_EQ(blocks[0], "");
+        REQUIRE_EQ(blocks[1], "int i = 0;\n");
+        REQUIRE_EQ(blocks[2], "#include <map>\n");
+        REQUIRE_EQ(blocks[3], "int j = i;");
+    }
+}
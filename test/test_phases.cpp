@@ -0,0 +1,127 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "xphases.hpp"
+
+namespace
+{
+    void wait_for(int ms)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+TEST_SUITE("phases")
+{
+    TEST_CASE("phase_name")
+    {
+        REQUIRE_EQ(std::string(xcpp::phase_name(xcpp::cell_phase::magics)), "magics");
+        REQUIRE_EQ(std::string(xcpp::phase_name(xcpp::cell_phase::instantiation)), "instantiation");
+        REQUIRE_EQ(std::string(xcpp::phase_name(xcpp::cell_phase::publish)), "publish");
+        REQUIRE_EQ(std::string(xcpp::phase_name(xcpp::cell_phase::none)), "none");
+    }
+
+    TEST_CASE("stopped_timer")
+    {
+        xcpp::phase_timer timer;
+        REQUIRE(timer.current() == xcpp::cell_phase::none);
+        REQUIRE_EQ(timer.total(), 0.);
+        REQUIRE_EQ(timer.duration(xcpp::cell_phase::parse), 0.);
+    }
+
+    TEST_CASE("phase_durations")
+    {
+        xcpp::phase_timer timer;
+        timer.start(xcpp::cell_phase::parse);
+        REQUIRE(timer.current() == xcpp::cell_phase::parse);
+        wait_for(5);
+        timer.enter(xcpp::cell_phase::execution);
+        wait_for(10);
+        timer.enter(xcpp::cell_phase::parse);
+        wait_for(5);
+        timer.stop();
+
+        REQUIRE(timer.current() == xcpp::cell_phase::none);
+        double parse = timer.duration(xcpp::cell_phase::parse);
+        double execution = timer.duration(xcpp::cell_phase::execution);
+        REQUIRE_GE(parse, 0.01);
+        REQUIRE_GE(execution, 0.01);
+        REQUIRE_EQ(timer.duration(xcpp::cell_phase::magics), 0.);
+        REQUIRE_EQ(timer.duration(xcpp::cell_phase::none), 0.);
+        REQUIRE_LE(parse + execution, timer.total());
+
+        // Nothing is accounted once the timer is stopped.
+        double total = timer.total();
+        wait_for(5);
+        REQUIRE_EQ(timer.total(), total);
+        REQUIRE_EQ(timer.duration(xcpp::cell_phase::parse), parse);
+    }
+
+    TEST_CASE("current_phase")
+    {
+        xcpp::phase_timer timer;
+        timer.start(xcpp::cell_phase::jit);
+        wait_for(5);
+        // The current phase is accounted up to now.
+        double jit = timer.duration(xcpp::cell_phase::jit);
+        REQUIRE_GE(jit, 0.005);
+        wait_for(5);
+        REQUIRE_GT(timer.duration(xcpp::cell_phase::jit), jit);
+        REQUIRE_GE(timer.total(), timer.duration(xcpp::cell_phase::jit));
+    }
+
+    TEST_CASE("restart")
+    {
+        xcpp::phase_timer timer;
+        timer.start(xcpp::cell_phase::execution);
+        wait_for(5);
+        timer.stop();
+        timer.start(xcpp::cell_phase::parse);
+        timer.stop();
+        REQUIRE_EQ(timer.duration(xcpp::cell_phase::execution), 0.);
+        REQUIRE_LT(timer.total(), 0.005);
+    }
+
+    TEST_CASE("to_json")
+    {
+        xcpp::phase_timer timer;
+        timer.start(xcpp::cell_phase::display);
+        wait_for(5);
+        timer.stop();
+        nl::json res = timer.to_json();
+        REQUIRE_EQ(res["total"].get<double>(), timer.total());
+        REQUIRE_EQ(res["phases"].size(), xcpp::cell_phase_count);
+        REQUIRE_EQ(res["phases"]["display"].get<double>(), timer.duration(xcpp::cell_phase::display));
+        REQUIRE_EQ(res["phases"]["parse"].get<double>(), 0.);
+    }
+
+    TEST_CASE("report")
+    {
+        xcpp::phase_timer timer;
+        timer.start(xcpp::cell_phase::split);
+        wait_for(5);
+        timer.enter(xcpp::cell_phase::publish);
+        wait_for(5);
+        timer.stop();
+        std::string report = timer.report();
+        REQUIRE_EQ(report.compare(0, 7, "Total: "), 0);
+        REQUIRE_NE(report.find("\n  split "), std::string::npos);
+        REQUIRE_NE(report.find("\n  publish "), std::string::npos);
+        REQUIRE_NE(report.find(" %\n"), std::string::npos);
+        // The phases which took no time are omitted.
+        REQUIRE_EQ(report.find("parse"), std::string::npos);
+    }
+}
@@ -0,0 +1,122 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xspill.hpp"
+
+namespace
+{
+    std::string read_file(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    bool file_exists(const std::string& path)
+    {
+        return std::ifstream(path).good();
+    }
+}
+
+TEST_SUITE("spill")
+{
+    TEST_CASE("created_on_first_write")
+    {
+        std::string path = xcpp::session_directory() + "/test_created.txt";
+        {
+            xcpp::spill_file file(path);
+            file.write("", 0);
+            REQUIRE_EQ(file.size(), 0u);
+            REQUIRE_FALSE(file_exists(path));
+
+            file.write("hello ", 6);
+            file.write("world", 5);
+            REQUIRE_EQ(file.path(), path);
+            REQUIRE_EQ(file.size(), 11u);
+        }
+        // The unused tail of the mapped window is dropped on destruction.
+        REQUIRE_EQ(read_file(path), "hello world");
+        xcpp::remove_session_directory();
+        REQUIRE_FALSE(file_exists(path));
+    }
+
+    TEST_CASE("across_windows")
+    {
+        // Larger than the 4 MiB mapped window, in chunks which do not
+        // divide it.
+        std::string chunk;
+        for (int i = 0; i < 1000; ++i)
+        {
+            chunk += static_cast<char>('a' + i % 26);
+        }
+        chunk += '\n';
+        std::string expected;
+        std::string path = xcpp::session_directory() + "/test_windows.txt";
+        {
+            xcpp::spill_file file(path);
+            while (expected.size() < (std::size_t(5) << 20))
+            {
+                file.write(chunk.data(), chunk.size());
+                expected += chunk;
+            }
+            REQUIRE_EQ(file.size(), expected.size());
+        }
+        REQUIRE(read_file(path) == expected);
+        xcpp::remove_session_directory();
+    }
+
+    TEST_CASE("concurrent_writes")
+    {
+        std::string path = xcpp::session_directory() + "/test_concurrent.txt";
+        {
+            xcpp::spill_file file(path);
+            std::vector<std::thread> writers;
+            for (int t = 0; t < 4; ++t)
+            {
+                writers.emplace_back(
+                    [&file, t]()
+                    {
+                        std::string line = "thread " + std::to_string(t) + "\n";
+                        for (int i = 0; i < 1000; ++i)
+                        {
+                            file.write(line.data(), line.size());
+                        }
+                    }
+                );
+            }
+            for (auto& w : writers)
+            {
+                w.join();
+            }
+            REQUIRE_EQ(file.size(), 4u * 1000u * 9u);
+        }
+
+        // Each write is kept whole.
+        std::istringstream lines(read_file(path));
+        std::vector<int> counts(4, 0);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            REQUIRE_EQ(line.size(), 8u);
+            REQUIRE_EQ(line.compare(0, 7, "thread "), 0);
+            ++counts[static_cast<std::size_t>(line[7] - '0')];
+        }
+        REQUIRE_EQ(counts, std::vector<int>(4, 1000));
+        xcpp::remove_session_directory();
+    }
+}
@@ -9,10 +9,16 @@
 
 #include "doctest/doctest.h"
 
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <list>
+#include <mutex>
+#include <ostream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "xeus-cling/xbuffer.hpp"
 
@@ -35,4 +41,307 @@ TEST_SUITE("stream")
         REQUIRE_EQ(outputs.front(), "Some output\n");
         std::cout.rdbuf(cout_strbuf);
     }
+
+    TEST_CASE("coalesced_output")
+    {
+        std::list<std::string> outputs;
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(50);
+        xcpp::xoutput_buffer buffer(std::bind(callback, _1, std::ref(outputs)), policy);
+        std::ostream out(&buffer);
+        std::string expected;
+        for (std::size_t i = 0; i < 1000; ++i)
+        {
+            out << "line " << i << std::endl;
+            expected += "line " + std::to_string(i) + "\n";
+        }
+        buffer.flush();
+
+        std::string received;
+        for (const auto& s : outputs)
+        {
+            received += s;
+        }
+        REQUIRE_EQ(received, expected);
+        REQUIRE_LT(outputs.size(), 1000);
+    }
+
+    TEST_CASE("background_output")
+    {
+        std::mutex mutex;
+        std::string received;
+        auto cb = [&](const std::string& value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            received += value;
+        };
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(10);
+        xcpp::xoutput_buffer buffer(cb, policy);
+        std::ostream out(&buffer);
+        out << "not flushed\n";
+
+        // The output is collected without any explicit flush, and published
+        // when the owner thread polls the buffer.
+        bool published = false;
+        for (std::size_t i = 0; i < 200 && !published; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            buffer.poll();
+            std::lock_guard<std::mutex> lock(mutex);
+            published = received == "not flushed\n";
+        }
+        REQUIRE(published);
+    }
+
+    TEST_CASE("owner_publishes")
+    {
+        std::vector<std::thread::id> publishers;
+        std::string received;
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(1);
+        policy.capacity = 256;
+        xcpp::xoutput_buffer buffer(
+            [&](const std::string& value)
+            {
+                publishers.push_back(std::this_thread::get_id());
+                received += value;
+            },
+            policy
+        );
+
+        // Neither the background thread nor the writers publish, even when
+        // the ring is full.
+        buffer.begin_cell();
+        std::thread writer(
+            [&buffer]()
+            {
+                std::ostream out(&buffer);
+                for (std::size_t i = 0; i < 1000; ++i)
+                {
+                    out << "line " << i << std::endl;
+                }
+            }
+        );
+        writer.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE(publishers.empty());
+
+        std::ostream out(&buffer);
+        out << "done" << std::endl;
+        buffer.end_cell();
+        REQUIRE_FALSE(publishers.empty());
+        for (const auto& id : publishers)
+        {
+            REQUIRE(id == std::this_thread::get_id());
+        }
+        REQUIRE_EQ(received.compare(0, 7, "line 0\n"), 0);
+        REQUIRE_EQ(received.compare(received.size() - 14, 14, "line 999\ndone\n"), 0);
+    }
+
+    TEST_CASE("concurrent_writers")
+    {
+        std::string received;
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(1);
+        policy.capacity = 4096;
+        xcpp::xoutput_buffer buffer(
+            [&](const std::string& value)
+            {
+                received += value;
+            },
+            policy
+        );
+
+        const std::size_t nthreads = 8;
+        const std::size_t nrecords = 1000;
+        std::vector<std::thread> writers;
+        for (std::size_t t = 0; t < nthreads; ++t)
+        {
+            writers.emplace_back(
+                [&buffer, t]()
+                {
+                    std::ostream out(&buffer);
+                    for (std::size_t i = 0; i < nrecords; ++i)
+                    {
+                        std::string record = "<" + std::to_string(t) + ":" + std::to_string(i) + ">\n";
+                        out.write(record.data(), static_cast<std::streamsize>(record.size()));
+                    }
+                }
+            );
+        }
+        for (auto& w : writers)
+        {
+            w.join();
+        }
+        buffer.flush();
+
+        // Records are never interleaved, and none of them is lost.
+        std::size_t count = 0;
+        std::size_t pos = 0;
+        while (pos < received.size())
+        {
+            REQUIRE_EQ(received[pos], '<');
+            std::size_t end = received.find(">\n", pos);
+            REQUIRE_NE(end, std::string::npos);
+            REQUIRE_EQ(received.find('<', pos + 1), received.find('<', end));
+            pos = end + 2;
+            ++count;
+        }
+        REQUIRE_EQ(count, nthreads * nrecords);
+    }
+
+    TEST_CASE("discarded_output")
+    {
+        std::list<std::string> outputs;
+        xcpp::xflush_policy policy;
+        policy.capacity = 64;
+        policy.overflow = xcpp::xoverflow_policy::discard;
+        xcpp::xoutput_buffer buffer(std::bind(callback, _1, std::ref(outputs)), policy);
+        std::ostream out(&buffer);
+        out << std::string(1024, 'x');
+        out << std::string(1024, 'y');
+        buffer.flush();
+
+        REQUIRE_EQ(outputs.size(), 1);
+        REQUIRE_EQ(outputs.front().find("yy"), std::string::npos);
+        REQUIRE_NE(outputs.front().find("bytes of output discarded"), std::string::npos);
+    }
+
+    TEST_CASE("line_atomic_output")
+    {
+        std::string received;
+        xcpp::xflush_policy policy;
+        policy.interval = std::chrono::milliseconds(1);
+        policy.tag_threads = true;
+        xcpp::xoutput_buffer buffer(
+            [&](const std::string& value)
+            {
+                received += value;
+            },
+            policy
+        );
+
+        // Lines written piecewise by several threads are not interleaved,
+        // and carry the index of the writing thread.
+        std::vector<std::thread> writers;
+        for (std::size_t t = 0; t < 4; ++t)
+        {
+            writers.emplace_back(
+                [&buffer]()
+                {
+                    std::ostream out(&buffer);
+                    for (std::size_t i = 0; i < 500; ++i)
+                    {
+                        out << "a" << 'b' << "c" << i << "d\n";
+                    }
+                }
+            );
+        }
+        for (auto& w : writers)
+        {
+            w.join();
+        }
+        buffer.flush();
+
+        std::istringstream lines(received);
+        std::string line;
+        std::size_t count = 0;
+        while (std::getline(lines, line))
+        {
+            REQUIRE_EQ(line.compare(0, 8, "[thread "), 0);
+            std::string content = line.substr(line.find("] ") + 2);
+            REQUIRE_EQ(content.compare(0, 3, "abc"), 0);
+            REQUIRE_EQ(content.back(), 'd');
+            ++count;
+        }
+        REQUIRE_EQ(count, 2000);
+
+        // The partial line of a thread is committed when it exits.
+        received.clear();
+        std::thread partial(
+            [&buffer]()
+            {
+                std::ostream out(&buffer);
+                out << "partial";
+            }
+        );
+        partial.join();
+        buffer.flush();
+        REQUIRE_NE(received.find("] partial"), std::string::npos);
+    }
+
+    TEST_CASE("destroyed_buffer")
+    {
+        // The partial line staged for a destroyed buffer is dropped, and its
+        // staging is reused by the next buffer written to by the thread.
+        {
+            xcpp::xoutput_buffer buffer(
+                [](const std::string&)
+                {
+                }
+            );
+            std::ostream out(&buffer);
+            out << "partial";
+        }
+        std::string received;
+        xcpp::xoutput_buffer buffer(
+            [&received](const std::string& s)
+            {
+                received += s;
+            }
+        );
+        std::ostream out(&buffer);
+        out << "line" << std::endl;
+        REQUIRE_EQ(received, "line\n");
+    }
+
+    TEST_CASE("cell_budget")
+    {
+        std::string received;
+        std::string spilled;
+        xcpp::xflush_policy policy;
+        policy.cell_max_bytes = 64;
+        policy.cell_max_messages = 4;
+        xcpp::xoutput_buffer buffer(
+            [&received](const std::string& s)
+            {
+                received += s;
+            },
+            policy
+        );
+        std::ostream out(&buffer);
+
+        buffer.begin_cell(
+            [&spilled](const char* s, std::size_t count)
+            {
+                spilled.append(s, count);
+            }
+        );
+        for (std::size_t i = 0; i < 100; ++i)
+        {
+            out << "line " << i << std::endl;
+        }
+        xcpp::xcell_output res = buffer.end_cell();
+
+        // The output is cut at a line boundary once a budget is exhausted.
+        REQUIRE_EQ(received, "line 0\nline 1\nline 2\nline 3\n");
+        REQUIRE_EQ(res.messages, 4);
+        REQUIRE_EQ(res.bytes, received.size());
+        REQUIRE_EQ(spilled.compare(0, 7, "line 4\n"), 0);
+        REQUIRE_EQ(res.spilled_bytes, spilled.size());
+
+        // The budget applies to each cell.
+        received.clear();
+        buffer.begin_cell();
+        out << std::string(100, 'x') << std::endl;
+        res = buffer.end_cell();
+        REQUIRE_EQ(received, std::string(64, 'x'));
+        REQUIRE_EQ(res.spilled_bytes, 37);
+
+        // Outside of a cell, nothing is limited.
+        received.clear();
+        out << std::string(100, 'y') << std::endl;
+        REQUIRE_EQ(received.size(), 101);
+    }
 }
@@ -0,0 +1,87 @@
+/***********************************************************************************
+* Copyright (c) 2016, Johan Mabille, Loic Gouarin, Sylvain Corlay, Wolf Vollprecht *
+* Copyright (c) 2016, QuantStack                                                   *
+*                                                                                  *
+* Distributed under the terms of the BSD 3-Clause License.                         *
+*                                                                                  *
+* The full license is in the file LICENSE, distributed with this software.         *
+************************************************************************************/
+
+#include "doctest/doctest.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "xcpp/xtimeit.hpp"
+
+TEST_SUITE("timeit")
+{
+    TEST_CASE("format_timespan")
+    {
+        REQUIRE_EQ(xcpp::format_timespan(1.5), "1.5 s");
+        REQUIRE_EQ(xcpp::format_timespan(123.456), "123 s");
+        REQUIRE_EQ(xcpp::format_timespan(0.0015), "1.5 ms");
+        REQUIRE_EQ(xcpp::format_timespan(2.5e-6), "2.5 us");
+        REQUIRE_EQ(xcpp::format_timespan(3e-9), "3 ns");
+        REQUIRE_EQ(xcpp::format_timespan(0.), "0 ns");
+        REQUIRE_EQ(xcpp::format_timespan(0.0123456, 5), "12.346 ms");
+    }
+
+    TEST_CASE("percentile")
+    {
+        std::vector<double> sorted;
+        for (int i = 1; i <= 20; ++i)
+        {
+            sorted.push_back(i);
+        }
+        REQUIRE_EQ(xcpp::detail::percentile(sorted, 0.), 1.);
+        REQUIRE_EQ(xcpp::detail::percentile(sorted, 0.5), 10.);
+        REQUIRE_EQ(xcpp::detail::percentile(sorted, 0.95), 19.);
+        REQUIRE_EQ(xcpp::detail::percentile(sorted, 1.), 20.);
+        REQUIRE_EQ(xcpp::detail::percentile({7.}, 0.95), 7.);
+        REQUIRE_EQ(xcpp::detail::percentile({}, 0.95), 0.);
+    }
+
+    TEST_CASE("median")
+    {
+        REQUIRE_EQ(xcpp::detail::median({1., 2., 10.}), 2.);
+        REQUIRE_EQ(xcpp::detail::median({1., 2., 3., 10.}), 2.5);
+        REQUIRE_EQ(xcpp::detail::median({}), 0.);
+    }
+
+    TEST_CASE("make_timeit_result")
+    {
+        std::vector<double> runs = {3., 1., 2., 4.};
+        xcpp::timeit_result res = xcpp::make_timeit_result(10, runs);
+        REQUIRE_EQ(res.loops, 10u);
+        REQUIRE_EQ(res.repeat, 4u);
+        // The runs are kept in their order.
+        REQUIRE(res.all_runs == runs);
+        REQUIRE_EQ(res.best, 1.);
+        REQUIRE_EQ(res.worst, 4.);
+        REQUIRE_EQ(res.median, 2.5);
+        REQUIRE_EQ(res.p95, 4.);
+        REQUIRE_LT(std::abs(res.mean - 2.5), 1e-12);
+        REQUIRE_LT(std::abs(res.stdev - std::sqrt(1.25)), 1e-12);
+    }
+
+    TEST_CASE("make_timeit_result_empty")
+    {
+        xcpp::timeit_result res = xcpp::make_timeit_result(5, {});
+        REQUIRE_EQ(res.loops, 5u);
+        REQUIRE_EQ(res.repeat, 0u);
+        REQUIRE_EQ(res.best, 0.);
+        REQUIRE_EQ(res.mean, 0.);
+        REQUIRE_EQ(res.stdev, 0.);
+    }
+
+    TEST_CASE("mime_bundle_repr")
+    {
+        nl::json bundle = xcpp::mime_bundle_repr(xcpp::make_timeit_result(7, {1e-3, 1e-3}));
+        REQUIRE_EQ(
+            bundle["text/plain"].get<std::string>(),
+            "<TimeitResult : 1 ms +- 0 ns per loop (mean +- std. dev. of 2 runs, 7 loops each)>"
+        );
+    }
+}
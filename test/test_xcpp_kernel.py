@@ -30,6 +30,10 @@ class XCppTests(jupyter_kernel_test.KernelTests):
         {
             'code': '6 * 7',
             'result': '42'
+        },
+        {
+            'code': '#include <string>\nstd::string("foobar")',
+            'result': '"foobar"'
         }
     ]
 
@@ -51,5 +55,13 @@ class XCppTests(jupyter_kernel_test.KernelTests):
         self.assertEqual(output_msgs[0]['content']['name'], 'stderr')
         self.assertEqual(output_msgs[0]['content']['text'], 'oops')
 
+    def test_xcpp_optimize_error(self):
+        reply, output_msgs = self.execute_helper(code='%%optimize -O2\nint i = undeclared_variable;')
+        self.assertEqual(reply['content']['status'], 'error')
+        self.assertEqual(reply['content']['ename'], 'Interpreter Error')
+        reply, output_msgs = self.execute_helper(code='%%optimize -O2\nint optimized_value = 42;')
+        self.assertEqual(reply['content']['status'], 'ok')
+        self.assertEqual(reply['content']['optimization']['level'], 2)
+
 if __name__ == '__main__':
     unittest.main()